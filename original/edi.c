@@ -0,0 +1,1275 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include "edi.h"
+#include "edisimd.h"
+#include "edirunner.h"
+
+/* vector kernels picked for this CPU on first use */
+static EdiSimd edi_simd;
+
+static gpointer
+edi_simd_once (G_GNUC_UNUSED gpointer data)
+{
+  edi_simd_init (&edi_simd);
+  return NULL;
+}
+
+static void
+edi_init (void)
+{
+  static GOnce once = G_ONCE_INIT;
+
+  g_once (&once, edi_simd_once, NULL);
+}
+
+const gchar *
+edi_get_simd_name (void)
+{
+  edi_init ();
+  return edi_simd.name;
+}
+
+/* CGAK picks one of these weightings per interpolated pixel.  The
+ * direction code is the row, 0 for flat areas (where a plain average is
+ * the same thing as row 1), negated when dx < 0; see edisimd.h. */
+static const int cgak_weights[6][4] = {
+  {0, 0, 0, 16},
+  {0, 0, 0, 16},
+  {0, 0, 8, 8},
+  {0, 4, 8, 4},
+  {1, 7, 7, 1},
+  {4, 8, 4, 0},
+};
+
+static int
+cgak_direction (int dx, int dy, int dx2)
+{
+  if (dy < 0) {
+    dy = -dy;
+    dx = -dx;
+  }
+
+  if (ABS (dx) <= 4 * ABS (dx2)) {
+    return 0;
+  } else if (dx < 0) {
+    if (dx < -2 * dy) {
+      return -1;
+    } else if (dx < -dy) {
+      return -2;
+    } else if (2 * dx < -dy) {
+      return -3;
+    } else if (3 * dx < -dy) {
+      return -4;
+    } else {
+      return -5;
+    }
+  } else {
+    if (dx > 2 * dy) {
+      return 1;
+    } else if (dx > dy) {
+      return 2;
+    } else if (2 * dx > dy) {
+      return 3;
+    } else if (3 * dx > dy) {
+      return 4;
+    } else {
+      return 5;
+    }
+  }
+}
+
+static inline int
+dirac_filter (int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7,
+    int max)
+{
+  int v;
+
+  v = -1 * s0 + 3 * s1 + -7 * s2 + 21 * s3 + 21 * s4 + -7 * s5 + 3 * s6
+      + -1 * s7;
+  v = (v + 16) >> 5;
+  return CLAMP (v, 0, max);
+}
+
+/* The six-tap half-pel filter (1 -5 20 20 -5 1) / 32 of Daala's
+ * od_state_upsample8, between s2 and s3. */
+static inline int
+daala_filter (int s0, int s1, int s2, int s3, int s4, int s5, int max)
+{
+  int v;
+
+  v = 20 * (s2 + s3) - 5 * (s1 + s4) + s0 + s5;
+  v = (v + 16) >> 5;
+  return CLAMP (v, 0, max);
+}
+
+/* One half of the six-tap filter, s0 and the two samples beyond it, times
+ * 16.  The edge-directed methods built on it take this in place of each
+ * sample of a CGAK interpolation. */
+static inline int
+sinc_filter (int s0, int s1, int s2)
+{
+  return 20 * s0 - 5 * s1 + s2;
+}
+
+/* One component of a frame, as the row functions see it.  Strides are in
+ * samples, data points at 8 or 16 bit ones. */
+typedef struct
+{
+  guint8 *src_data;
+  int src_stride;
+  int src_width;
+  int src_height;
+  guint8 *dest_data;
+  int dest_stride;
+  /* The output's size.  Upsampling, that is 2 * src_width x 2 *
+   * src_height but for subsampled planes of an odd-sized picture, which
+   * end short of the last interpolated column or row, or further into a
+   * cascade: what falls outside is not stored. */
+  int dest_width;
+  int dest_height;
+  int max_value;
+
+  /* Samples from one pixel to the next, 2 for the interleaved chroma of
+   * NV12.  Only the chroma rows look at these; luma is always packed. */
+  int src_pstride;
+  int dest_pstride;
+  /* Samples interpolated per pixel: 1, or 4 for packed RGB, whose
+   * channels all go through the luma rows together. */
+  int channels;
+
+  /* Packed RGB only: where R, G and B are in a pixel, and the luma
+   * estimate the directions are found on, dir_stride samples a row. */
+  int rgb_offset[3];
+  guint8 *luma_data;
+
+  /* CGAK directions of the luma plane, or NULL when they are not kept.
+   * dir_h has a code per source pixel for the gap to its right, dir_v one
+   * per horizontally upsampled pixel for the gap below it, both with
+   * dir_stride codes per source row, of dir_height rows.  Chroma planes
+   * index them shifted by their subsampling, clamped to the last row and
+   * column where the chroma of a cascade reaches past the luma. */
+  gint8 *dir_h;
+  gint8 *dir_v;
+  int dir_stride;
+  int dir_height;
+  int x_shift;
+  int y_shift;
+
+  /* CGAK luma only: for the blocks of FLAT_BLOCK x FLAT_BLOCK source
+   * pixels from block row flat_row0 on, the one value the block's output
+   * takes, or -1 when it has to be worked out.  NULL for none. */
+  const int *flat;
+  int flat_stride;
+  int flat_row0;
+
+  /* With the phase layout, the planes the interpolated pixels go to, in
+   * place of dest_data, which is then NULL: H right of the source pixels,
+   * V below them and D below and right, dest_pstride samples a pixel.
+   * NULL when the output is interleaved. */
+  guint8 *phase_data[3];
+  int phase_stride[3];
+
+  /* Deinterlacing only: the parity of the rows of the field kept, whose
+   * picture the others are rebuilt for. */
+  int field;
+
+  /* CGAK luma only: unless NULL, the line functions count how many of
+   * the interpolated pixels of each source row took each direction, in a
+   * row of EDI_DIR_MAP_N_CODES counts per source row.  As in the map,
+   * the last column and the last row pair are source pixels. */
+  guint *dir_counts;
+
+  /* Line buffers for the rows function, band_scratch_size() bytes.  One
+   * that calls another passes it what it does not use itself. */
+  guint8 *scratch;
+} EdiPlane;
+
+/* Every method is split into passes over a band of source rows [j0, j1).
+ * Within a pass the bands are independent: a band may read source rows
+ * outside itself, and anything the previous pass wrote, but only writes
+ * the destination rows 2 * j0 to 2 * j1 - 1.  Methods that get by with
+ * one pass over the luma leave the second one NULL. */
+typedef void (*EdiRowsFunc) (const EdiPlane * p,
+    int j0, int j1);
+
+#define N_PASSES 3
+
+typedef struct
+{
+  EdiRowsFunc luma[N_PASSES];
+  EdiRowsFunc chroma;
+  /* chroma along the luma directions, for methods that keep them */
+  EdiRowsFunc guided_chroma;
+  /* all channels of packed RGB at once, in place of luma and chroma */
+  EdiRowsFunc packed[N_PASSES];
+  /* Deinterlacing, for the methods that can, in a single pass over rows
+   * that are not upsampled: j is a pair of output rows 2 * j and
+   * 2 * j + 1, one of each field. */
+  EdiRowsFunc field_luma;
+  EdiRowsFunc field_chroma;
+} EdiMethodRows;
+
+#define MARGIN 3
+
+#define FLAT_BLOCK 16
+
+/* The methods modelled on od_state_upsample8 stream their upsampled lines
+ * through a ring of this many, like its ref_line_buf. */
+#define RING_LINES 8
+
+/* The pieces the rows functions cut the scratch into are rounded up to
+ * this, so that each starts aligned. */
+#define SCRATCH_ROUND(size) (((size) + 31) & ~(gsize) 31)
+
+/* Where the run of blocks holding pixel i of row j ends, at most at end:
+ * blocks that are all flat with the same value, returned in value, or
+ * all not, with value -1.  i and end are in source pixels << shift. */
+static int
+flat_run (const EdiPlane * p, int i, int j, int shift, int end, int *value)
+{
+  const int *flat;
+  int b;
+
+  *value = -1;
+  if (!p->flat)
+    return end;
+
+  flat = p->flat + p->flat_stride * (j / FLAT_BLOCK - p->flat_row0);
+  b = (i >> shift) / FLAT_BLOCK;
+  *value = flat[b];
+  do
+    b++;
+  while (b < p->flat_stride && flat[b] == *value);
+
+  return MIN ((b * FLAT_BLOCK) << shift, end);
+}
+
+/* Adds the directions of the n interpolated pixels of a line of source
+ * row j to the row's counts, which the first line of the row starts
+ * over.  Past the vector kernel, four tables take the pixels in turn, so
+ * that a run of one direction does not wait on its own increments. */
+static void
+count_line_dirs (const EdiPlane * p, int j, const gint8 * dir, int n,
+    gboolean first)
+{
+  guint counts[4][EDI_DIR_MAP_N_CODES];
+  guint *row = p->dir_counts + EDI_DIR_MAP_N_CODES * j;
+  int i, m;
+
+  memset (counts, 0, sizeof (counts));
+  i = edi_simd.count_dirs (counts[0] + EDI_DIR_MAP_FLAT - 5, dir, n);
+  for (; i + 4 <= n; i += 4) {
+    counts[0][EDI_DIR_MAP_FLAT + dir[i]]++;
+    counts[1][EDI_DIR_MAP_FLAT + dir[i + 1]]++;
+    counts[2][EDI_DIR_MAP_FLAT + dir[i + 2]]++;
+    counts[3][EDI_DIR_MAP_FLAT + dir[i + 3]]++;
+  }
+  for (; i < n; i++)
+    counts[0][EDI_DIR_MAP_FLAT + dir[i]]++;
+
+  for (m = 0; m < EDI_DIR_MAP_N_CODES; m++) {
+    row[m] = (first ? 0 : row[m]) + counts[0][m] + counts[1][m] +
+        counts[2][m] + counts[3][m];
+  }
+}
+
+#define PIXEL guint8
+#define PIXEL_MAX(p) 255
+#define EDI_FUNC(f) f ## _u8
+#define EDI_SIMD 1
+#include "edirows.h"
+#undef PIXEL
+#undef PIXEL_MAX
+#undef EDI_FUNC
+#undef EDI_SIMD
+
+#define PIXEL guint16
+#define PIXEL_MAX(p) ((p)->max_value)
+#define EDI_FUNC(f) f ## _u16
+#define EDI_SIMD 0
+#include "edirows.h"
+#undef PIXEL
+#undef PIXEL_MAX
+#undef EDI_FUNC
+#undef EDI_SIMD
+
+/* Lays out the image of in upsampled by 1 << shift, with bps bytes per
+ * sample, at data, and returns how many bytes it takes.  With data NULL
+ * only the size is computed.  Each component gets a plane of its own,
+ * whatever the layout of in. */
+static gsize
+image_scratch (EdiImage * img, const EdiImage * in,
+    int shift, int bps, guint8 * data)
+{
+  gsize offset = 0;
+  int k;
+
+  *img = *in;
+  for (k = 0; k < in->n_components; k++) {
+    img->width[k] = in->width[k] << shift;
+    img->height[k] = in->height[k] << shift;
+    img->pstride[k] = bps * in->channels;
+    img->stride[k] = (img->width[k] * img->pstride[k] + 31) & ~31;
+    img->data[k] = data ? data + offset : NULL;
+    offset += img->stride[k] * img->height[k];
+  }
+
+  return offset;
+}
+
+/* The scratch a band needs to upsample a picture of width x height luma
+ * pixels with bps bytes per sample: the flat blocks of CGAK, and then
+ * RING_LINES upsampled lines of up to four samples a pixel, more than
+ * any rows function streams through at once. */
+static gsize
+band_scratch_size (int width, int height, int bps)
+{
+  int flat_stride = (width + FLAT_BLOCK - 1) / FLAT_BLOCK;
+  gsize flat = (height / FLAT_BLOCK + 1) * flat_stride * sizeof (int);
+
+  return SCRATCH_ROUND (flat) + RING_LINES * 2 * width * 4 * bps;
+}
+
+/* A range of source luma rows [j0, j1) to upsample. */
+typedef struct
+{
+  int j0;
+  int j1;
+} EdiRows;
+
+typedef struct
+{
+  const EdiImage *src;
+  const EdiImage *dest;
+  /* the H, V and D images of the phase layout, in place of dest, or
+   * NULL */
+  const EdiImage *phases;
+  EdiRowsFunc luma;
+  EdiRowsFunc chroma;
+  gint8 *dirs;
+  guint8 *dir_map;
+  int dir_map_stride;
+  /* the direction counts of the source rows, see EdiPlane, or NULL */
+  guint *dir_counts;
+  /* the border to fill around the band's output rows, or 0 */
+  int padding;
+  /* every band takes its share of each range */
+  const EdiRows *rows;
+  int n_rows;
+  guint index;
+  guint n_bands;
+  /* deinterlacing only, see EdiPlane */
+  int field;
+  /* see EdiPlane */
+  guint8 *scratch;
+} EdiBand;
+
+/* The band's share of range r in the rows of a component subsampled by
+ * y_shift, FALSE when it is empty. */
+static gboolean
+band_rows (EdiBand * band, int r, int y_shift, int *j0, int *j1)
+{
+  const EdiRows *rows = &band->rows[r];
+  int height = rows->j1 - rows->j0;
+  int round = (1 << y_shift) - 1;
+
+  *j0 = rows->j0 + height * band->index / band->n_bands;
+  *j1 = rows->j0 + height * (band->index + 1) / band->n_bands;
+  *j0 = (*j0 + round) >> y_shift;
+  *j1 = (*j1 + round) >> y_shift;
+
+  return *j0 < *j1;
+}
+
+static void
+run_band_plane (EdiBand * band, EdiRowsFunc func, int k)
+{
+  const EdiImage *src = band->src;
+  const EdiImage *phases = band->phases;
+  EdiPlane p;
+  int bps = src->depth > 8 ? 2 : 1;
+  int j0, j1, c, r, m;
+
+  if (!func)
+    return;
+
+  p.src_data = src->data[k];
+  p.src_stride = src->stride[k] / bps;
+  p.src_width = src->width[k];
+  p.src_height = src->height[k];
+  p.src_pstride = src->pstride[k] / bps;
+  if (phases) {
+    p.dest_data = NULL;
+    p.dest_stride = 0;
+    p.dest_width = 2 * src->width[k];
+    p.dest_height = 2 * src->height[k];
+    p.dest_pstride = phases[0].pstride[k] / bps;
+    for (m = 0; m < 3; m++) {
+      p.phase_data[m] = phases[m].data[k];
+      p.phase_stride[m] = phases[m].stride[k] / bps;
+    }
+  } else {
+    p.dest_data = band->dest->data[k];
+    p.dest_stride = band->dest->stride[k] / bps;
+    p.dest_width = band->dest->width[k];
+    p.dest_height = band->dest->height[k];
+    p.dest_pstride = band->dest->pstride[k] / bps;
+    p.phase_data[0] = NULL;
+  }
+  p.channels = src->channels;
+  p.max_value = (1 << src->depth) - 1;
+  for (c = 0; c < 3; c++)
+    p.rgb_offset[c] = src->rgb_offset[c] / bps;
+
+  p.dir_h = band->dirs;
+  p.dir_stride = src->width[0];
+  p.dir_height = src->height[0];
+  p.dir_v = band->dirs ? band->dirs + p.dir_stride * src->height[0] : NULL;
+  p.x_shift = src->x_shift[k];
+  p.y_shift = src->y_shift[k];
+  /* the luma estimate of packed RGB follows the direction maps */
+  p.luma_data = band->dirs ?
+      (guint8 *) band->dirs + 3 * p.dir_stride * src->height[0] : NULL;
+  p.flat = NULL;
+  p.field = band->field;
+  p.scratch = band->scratch;
+  p.dir_counts = k == 0 ? band->dir_counts : NULL;
+
+  for (r = 0; r < band->n_rows; r++) {
+    band_rows (band, r, p.y_shift, &j0, &j1);
+    /* In a cascade, the chroma of an odd-sized picture has rows below
+     * those of the luma, which the next stage reads all the same. */
+    if (band->rows[r].j1 == src->height[0] &&
+        band->index == band->n_bands - 1)
+      j1 = p.src_height;
+    if (j0 < j1)
+      func (&p, j0, j1);
+  }
+}
+
+/* Repeats the edge pixels of output rows [j0, j1) of component k into the
+ * border of padding pixels around them, and the first and last rows of
+ * the component into the border above and below it when they are among
+ * them. */
+static void
+pad_rows (const EdiImage * dest, int k, int j0, int j1, int padding)
+{
+  int bps = dest->depth > 8 ? 2 : 1;
+  int size = bps * dest->channels;
+  int ps = dest->pstride[k];
+  int stride = dest->stride[k];
+  int x_pad = padding >> dest->x_shift[k];
+  int y_pad = padding >> dest->y_shift[k];
+  int height = dest->height[k];
+  gsize row_size = (dest->width[k] - 1 + 2 * x_pad) * ps + size;
+  guint8 *data = dest->data[k];
+  int i, j;
+
+  for (j = j0; j < j1; j++) {
+    guint8 *left = data + stride * j;
+    guint8 *right = left + ps * (dest->width[k] - 1);
+
+    if (ps == 1) {
+      memset (left - x_pad, left[0], x_pad);
+      memset (right + 1, right[0], x_pad);
+    } else {
+      for (i = 1; i <= x_pad; i++) {
+        memcpy (left - i * ps, left, size);
+        memcpy (right + i * ps, right, size);
+      }
+    }
+  }
+
+  /* the rows above and below are copies of whole padded rows */
+  data -= x_pad * ps;
+  if (j0 == 0 && j1 > 0) {
+    for (j = 1; j <= y_pad; j++)
+      memcpy (data - stride * j, data, row_size);
+  }
+  if (j1 == height && j0 < j1) {
+    for (j = 1; j <= y_pad; j++)
+      memcpy (data + stride * (height - 1 + j),
+          data + stride * (height - 1), row_size);
+  }
+}
+
+/* Pads the band's output rows of every component, once they are done. */
+static void
+pad_band (EdiBand * band)
+{
+  const EdiImage *dest = band->dest;
+  int j0, j1, k, r;
+
+  for (k = 0; k < dest->n_components; k++) {
+    for (r = 0; r < band->n_rows; r++) {
+      if (band_rows (band, r, dest->y_shift[k], &j0, &j1)) {
+        pad_rows (dest, k, 2 * j0, MIN (2 * j1, dest->height[k]),
+            band->padding);
+      }
+    }
+  }
+}
+
+/* Packs the directions of the band's output rows into the map.  The last
+ * column and the last row pair repeat source pixels, so they are coded
+ * as such. */
+static void
+pack_band_dirs (EdiBand * band)
+{
+  int src_width = band->src->width[0];
+  int src_height = band->src->height[0];
+  int i, j, j0, j1;
+
+  /* a dir_map is only filled in one range, the whole picture */
+  if (!band_rows (band, 0, 0, &j0, &j1))
+    return;
+
+  for (j = j0; j < MIN (j1, src_height - 1); j++) {
+    gint8 *dir_h = band->dirs + src_width * j;
+    gint8 *dir_v = band->dirs + src_width * (src_height + 2 * j);
+    guint8 *d1 = band->dir_map + band->dir_map_stride * 2 * j;
+    guint8 *d2 = band->dir_map + band->dir_map_stride * (2 * j + 1);
+
+    for (i = 0; i < src_width - 1; i++) {
+      d1[i] = EDI_DIR_MAP_SOURCE | (EDI_DIR_MAP_FLAT + dir_h[i]) << 4;
+      d2[i] = (EDI_DIR_MAP_FLAT + dir_v[2 * i]) |
+          (EDI_DIR_MAP_FLAT + dir_v[2 * i + 1]) << 4;
+    }
+    d1[i] = EDI_DIR_MAP_SOURCE | EDI_DIR_MAP_SOURCE << 4;
+    d2[i] = (EDI_DIR_MAP_FLAT + dir_v[2 * i]) |
+        (EDI_DIR_MAP_FLAT + dir_v[2 * i + 1]) << 4;
+  }
+  if (j1 == src_height) {
+    for (j = 2 * src_height - 2; j < 2 * src_height; j++)
+      memset (band->dir_map + band->dir_map_stride * j,
+          EDI_DIR_MAP_SOURCE | EDI_DIR_MAP_SOURCE << 4, src_width);
+  }
+}
+
+static void
+run_band (gpointer data)
+{
+  EdiBand *band = data;
+  int k;
+
+  run_band_plane (band, band->luma, 0);
+  if (band->luma && band->dir_map)
+    pack_band_dirs (band);
+  for (k = 1; k < band->src->n_components; k++)
+    run_band_plane (band, band->chroma, k);
+  /* while the rows are still in cache */
+  if (band->padding > 0)
+    pad_band (band);
+}
+
+/* How many source rows on either side the output of a row may depend
+ * on, in any method and component: edi-hv interpolates between lines
+ * that CGAK-style taps upsampled from MARGIN rows further.  A pass reads
+ * that far into what the previous one left behind. */
+#define HALO (2 * MARGIN)
+
+/* Finds the luma rows where any component of in differs from prev, as
+ * ranges into rows.  Returns how many ranges there are. */
+static int
+changed_rows (const EdiImage * in, const EdiImage * prev, EdiRows * rows)
+{
+  int bps = in->depth > 8 ? 2 : 1;
+  int n_rows = 0, until = 0;
+  int j, k;
+
+  for (j = 0; j < in->height[0]; j++) {
+    for (k = 0; k < in->n_components; k++) {
+      int y_shift = in->y_shift[k];
+      int jc = j >> y_shift;
+      gsize size = (in->width[k] - 1) * in->pstride[k] + bps * in->channels;
+
+      /* a subsampled row is looked at on the first luma row it covers */
+      if (jc << y_shift != j || until >= j + (1 << y_shift))
+        continue;
+      if (memcmp (in->data[k] + in->stride[k] * jc,
+              prev->data[k] + prev->stride[k] * jc, size) != 0)
+        until = j + (1 << y_shift);
+    }
+
+    if (until <= j)
+      continue;
+    if (n_rows > 0 && rows[n_rows - 1].j1 == j) {
+      rows[n_rows - 1].j1++;
+    } else {
+      rows[n_rows].j0 = j;
+      rows[n_rows].j1 = j + 1;
+      n_rows++;
+    }
+  }
+
+  return n_rows;
+}
+
+/* Turns ranges of changed rows, scaled by scale, into the rows to
+ * upsample again: halo rows further on either side, out to even rows so
+ * that subsampled components line up, merged when closer than 2 * spread
+ * so that they still do not overlap when widened by spread for the
+ * earlier passes.  Works in place and returns the new number of ranges. */
+static int
+grow_rows (EdiRows * rows, int n_rows, int scale, int halo, int spread,
+    int height)
+{
+  int n = 0, r;
+
+  for (r = 0; r < n_rows; r++) {
+    int j0 = MAX (rows[r].j0 * scale - halo, 0) & ~1;
+    int j1 = MIN ((rows[r].j1 * scale + halo + 1) & ~1, height);
+
+    if (n > 0 && rows[n - 1].j1 + 2 * spread > j0) {
+      rows[n - 1].j1 = MAX (rows[n - 1].j1, j1);
+    } else {
+      rows[n].j0 = j0;
+      rows[n].j1 = j1;
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/* Copies the output of the source rows outside the ranges from prev,
+ * scale rows of it per source row, and pads it by padding pixels. */
+static void
+copy_rows (const EdiImage * dest, const EdiImage * prev,
+    const EdiRows * rows, int n_rows, int height, int scale, int padding)
+{
+  int bps = dest->depth > 8 ? 2 : 1;
+  int j, k, r;
+
+  for (k = 0; k < dest->n_components; k++) {
+    int y_shift = dest->y_shift[k];
+    int round = (1 << y_shift) - 1;
+    gsize size = (dest->width[k] - 1) * dest->pstride[k] +
+        bps * dest->channels;
+    int j0 = 0, j1;
+
+    for (r = 0; r <= n_rows; r++) {
+      j1 = r < n_rows ? rows[r].j0 : height;
+      j1 = MIN (scale * ((j1 + round) >> y_shift), dest->height[k]);
+      for (j = scale * ((j0 + round) >> y_shift); j < j1; j++) {
+        memcpy (dest->data[k] + dest->stride[k] * j,
+            prev->data[k] + prev->stride[k] * j, size);
+      }
+      if (padding > 0)
+        pad_rows (dest, k, scale * ((j0 + round) >> y_shift), j1, padding);
+      if (r < n_rows)
+        j0 = rows[r].j1;
+    }
+  }
+}
+
+/* Copies the output of the source rows in the ranges, scale rows of it
+ * per source row, from dest to save, which is what copy_rows() leaves
+ * out. */
+static void
+save_rows (const EdiImage * save, const EdiImage * dest,
+    const EdiRows * rows, int n_rows, int scale)
+{
+  int bps = dest->depth > 8 ? 2 : 1;
+  int j, k, r;
+
+  for (k = 0; k < dest->n_components; k++) {
+    int y_shift = dest->y_shift[k];
+    int round = (1 << y_shift) - 1;
+    gsize size = (dest->width[k] - 1) * dest->pstride[k] +
+        bps * dest->channels;
+
+    for (r = 0; r < n_rows; r++) {
+      int j1 = MIN (scale * ((rows[r].j1 + round) >> y_shift),
+          dest->height[k]);
+
+      for (j = scale * ((rows[r].j0 + round) >> y_shift); j < j1; j++) {
+        memcpy (save->data[k] + save->stride[k] * j,
+            dest->data[k] + dest->stride[k] * j, size);
+      }
+    }
+  }
+}
+
+struct _EdiUpsampler
+{
+  EdiRunner *runner;
+  /* CGAK luma directions of the current picture, when something uses
+   * them */
+  gint8 *dirs;
+  gsize dirs_size;
+  /* two images between the steps of a cascade */
+  guint8 *scratch;
+  gsize scratch_size;
+  /* the output around a region of interest */
+  guint8 *roi_scratch;
+  gsize roi_scratch_size;
+  /* the line buffers of the bands, one after the other */
+  guint8 *band_scratch;
+  gsize band_scratch_size;
+  /* the direction counts of each source row of the last stage, and
+   * whether the last run left them there */
+  guint *row_counts;
+  int row_counts_size;
+  gboolean have_row_counts;
+  /* the rows to upsample again when given the previous picture, twice:
+   * as they are and widened for the passes before the last */
+  EdiRows *rows;
+  int rows_size;
+  /* the last run, whose cascade the scratch images still hold */
+  gboolean have_last;
+  EdiParams last_params;
+  EdiImage last_src;
+};
+
+/* Whether upsampling src with params takes the same steps and buffers as
+ * the last run did. */
+static gboolean
+same_as_last (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src)
+{
+  const EdiParams *lp = &upsampler->last_params;
+  const EdiImage *ls = &upsampler->last_src;
+  int k;
+
+  if (!upsampler->have_last || lp->method != params->method ||
+      lp->chroma_mode != params->chroma_mode ||
+      lp->n_stages != params->n_stages ||
+      ls->n_components != src->n_components ||
+      ls->channels != src->channels || ls->depth != src->depth)
+    return FALSE;
+
+  for (k = 0; k < 3; k++) {
+    if (ls->rgb_offset[k] != src->rgb_offset[k])
+      return FALSE;
+  }
+  for (k = 0; k < src->n_components; k++) {
+    if (ls->width[k] != src->width[k] || ls->height[k] != src->height[k] ||
+        ls->x_shift[k] != src->x_shift[k] ||
+        ls->y_shift[k] != src->y_shift[k])
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+EdiUpsampler *
+edi_upsampler_new (guint n_threads)
+{
+  EdiUpsampler *upsampler;
+
+  edi_init ();
+
+  upsampler = g_new0 (EdiUpsampler, 1);
+  edi_upsampler_set_n_threads (upsampler, n_threads);
+
+  return upsampler;
+}
+
+void
+edi_upsampler_free (EdiUpsampler * upsampler)
+{
+  edi_runner_free (upsampler->runner);
+  g_free (upsampler->dirs);
+  g_free (upsampler->scratch);
+  g_free (upsampler->roi_scratch);
+  g_free (upsampler->band_scratch);
+  g_free (upsampler->row_counts);
+  g_free (upsampler->rows);
+  g_free (upsampler);
+}
+
+void
+edi_upsampler_set_n_threads (EdiUpsampler * upsampler, guint n_threads)
+{
+  if (n_threads == 0)
+    n_threads = g_get_num_processors ();
+
+  if (upsampler->runner &&
+      edi_runner_get_n_threads (upsampler->runner) == n_threads)
+    return;
+
+  g_clear_pointer (&upsampler->runner, edi_runner_free);
+  upsampler->runner = edi_runner_new (n_threads);
+}
+
+guint
+edi_upsampler_get_n_threads (EdiUpsampler * upsampler)
+{
+  return edi_runner_get_n_threads (upsampler->runner);
+}
+
+/* Whether img has the layout of src at a luma size of width x height,
+ * with every other component subsampled from it the same way, rounding
+ * up. */
+static gboolean
+image_fits (const EdiImage * img, const EdiImage * src, int width,
+    int height)
+{
+  int k;
+
+  if (img->n_components != src->n_components ||
+      img->channels != src->channels || img->depth != src->depth)
+    return FALSE;
+
+  for (k = 0; k < src->n_components; k++) {
+    int x_shift = src->x_shift[k];
+    int y_shift = src->y_shift[k];
+
+    if (img->x_shift[k] != x_shift || img->y_shift[k] != y_shift ||
+        img->width[k] != (width + (1 << x_shift) - 1) >> x_shift ||
+        img->height[k] != (height + (1 << y_shift) - 1) >> y_shift)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Upsamples src into dest, or into the three phases when dest is NULL. */
+static void
+upsampler_run (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src, const EdiImage * dest, const EdiImage * phases)
+{
+  EdiImage *scratch;
+  const EdiImage *in, *out;
+  const EdiMethodRows *rows;
+  const EdiRowsFunc *luma_rows;
+  EdiBand *bands;
+  gpointer *band_data;
+  EdiRowsFunc chroma;
+  EdiRows whole, *dirty = &whole, *wide = &whole;
+  gint8 *dirs = NULL;
+  gsize scratch_size = 0, band_size;
+  guint n_threads = edi_runner_get_n_threads (upsampler->runner);
+  int n_stages = params->n_stages;
+  int bps = src->depth > 8 ? 2 : 1;
+  gboolean packed = src->channels > 1;
+  gboolean counting = params->method == EDI_METHOD_CGAK &&
+      params->dir_counts != NULL;
+  gboolean incremental;
+  guint i;
+  int pass, chroma_pass, dirs_pass, stage;
+  int n_later[N_PASSES], n_passes = 0, last_pass = 0;
+  int n_dirty = 1, halo = HALO, last_height, r, k, m;
+
+  rows = (bps == 2 ? methods_u16 : methods_u8) + params->method;
+
+  /* Each stage of a cascade but the last has a scratch image of its own,
+   * which the next run starts from incrementally.  Together they take
+   * less than two of the largest. */
+  scratch = g_newa (EdiImage, n_stages);
+  for (stage = 0; stage < n_stages - 1; stage++)
+    scratch_size += image_scratch (&scratch[stage], src, stage + 1, bps, NULL);
+  if (upsampler->scratch_size < scratch_size) {
+    g_free (upsampler->scratch);
+    upsampler->scratch = g_malloc (scratch_size);
+    upsampler->scratch_size = scratch_size;
+  }
+  scratch_size = 0;
+  for (stage = 0; stage < n_stages - 1; stage++)
+    scratch_size += image_scratch (&scratch[stage], src, stage + 1, bps,
+        upsampler->scratch + scratch_size);
+
+  /* the bands' line buffers, sized for the last stage */
+  band_size = band_scratch_size (src->width[0] << (n_stages - 1),
+      src->height[0] << (n_stages - 1), bps);
+  if (upsampler->band_scratch_size < n_threads * band_size) {
+    g_free (upsampler->band_scratch);
+    upsampler->band_scratch = g_malloc (n_threads * band_size);
+    upsampler->band_scratch_size = n_threads * band_size;
+  }
+
+  luma_rows = rows->luma;
+  chroma = rows->chroma;
+  chroma_pass = 0;
+  dirs_pass = 0;
+  if (params->method == EDI_METHOD_CGAK && (packed ||
+          params->chroma_mode == EDI_CHROMA_MODE_LUMA_GUIDED ||
+          params->dir_map)) {
+    /* sized for the luma going into the last stage */
+    gsize size = (src->width[0] << (n_stages - 1)) *
+        (src->height[0] << (n_stages - 1));
+
+    /* packed RGB also keeps its luma estimate there */
+    size *= packed ? 3 + bps : 3;
+
+    if (upsampler->dirs_size < size) {
+      g_free (upsampler->dirs);
+      upsampler->dirs = g_malloc (size);
+      upsampler->dirs_size = size;
+    }
+    dirs = upsampler->dirs;
+  }
+  /* Guided chroma follows the luma directions, so it has to wait for the
+   * whole luma plane instead of riding along with its first pass. */
+  if (packed) {
+    /* the directions come from a luma estimate, a pass of its own */
+    luma_rows = rows->packed;
+    chroma = NULL;
+    dirs_pass = 1;
+  } else if (dirs && params->chroma_mode == EDI_CHROMA_MODE_LUMA_GUIDED) {
+    chroma = rows->guided_chroma;
+    chroma_pass = N_PASSES - 1;
+  }
+  /* passes still to come after each one, which need it to have gone
+   * further */
+  for (pass = N_PASSES - 1; pass >= 0; pass--) {
+    n_later[pass] = n_passes;
+    if (luma_rows[pass] || pass == chroma_pass) {
+      if (n_passes == 0)
+        last_pass = pass;
+      n_passes++;
+    }
+  }
+
+  /* The line functions count the directions of each source row going
+   * into the last stage, which are added up in the end. */
+  last_height = src->height[0] << (n_stages - 1);
+  if (counting && upsampler->row_counts_size < last_height) {
+    g_free (upsampler->row_counts);
+    upsampler->row_counts = g_new (guint, EDI_DIR_MAP_N_CODES * last_height);
+    upsampler->row_counts_size = last_height;
+  }
+
+  /* Incrementally, only the rows around those that changed since the
+   * previous picture go through the passes, in every stage.  Below the
+   * last stage the rest is still in the scratch images, in the last one
+   * it is copied over, and its direction counts kept. */
+  incremental = params->prev_src && params->prev_dest && !params->dir_map &&
+      same_as_last (upsampler, params, src) &&
+      (!counting || upsampler->have_row_counts);
+  if (incremental) {
+    if (upsampler->rows_size < src->height[0] + 1) {
+      g_free (upsampler->rows);
+      upsampler->rows_size = src->height[0] + 1;
+      upsampler->rows = g_new (EdiRows, 2 * upsampler->rows_size);
+    }
+    dirty = upsampler->rows;
+    wide = upsampler->rows + upsampler->rows_size;
+    n_dirty = changed_rows (src, params->prev_src, dirty);
+    for (k = 0; k < src->n_components; k++)
+      halo = MAX (halo, HALO << src->y_shift[k]);
+  }
+  upsampler->have_last = TRUE;
+  upsampler->last_params = *params;
+  upsampler->last_src = *src;
+  upsampler->have_row_counts = counting;
+
+  bands = g_newa (EdiBand, n_threads);
+  band_data = g_newa (gpointer, n_threads);
+  for (i = 0; i < n_threads; i++) {
+    bands[i].dirs = dirs;
+    bands[i].dir_map_stride = params->dir_map_stride;
+    bands[i].index = i;
+    bands[i].n_bands = n_threads;
+    bands[i].field = 0;
+    bands[i].scratch = upsampler->band_scratch + i * band_size;
+    band_data[i] = &bands[i];
+  }
+
+  in = src;
+  for (stage = 0; stage < n_stages; stage++) {
+    out = stage == n_stages - 1 ? dest : &scratch[stage];
+
+    if (incremental) {
+      n_dirty = grow_rows (dirty, n_dirty, stage ? 2 : 1, halo,
+          halo * (n_passes - 1), in->height[0]);
+      if (out == dest && phases) {
+        for (m = 0; m < 3; m++)
+          copy_rows (&phases[m], &params->prev_dest[m], dirty, n_dirty,
+              in->height[0], 1, 0);
+      } else if (out == dest) {
+        copy_rows (dest, params->prev_dest, dirty, n_dirty, in->height[0],
+            2, params->padding);
+      }
+    } else {
+      whole.j0 = 0;
+      whole.j1 = in->height[0];
+    }
+
+    /* each pass needs the complete output of the previous one around its
+     * band, so the passes are separated by waiting for every band */
+    for (pass = 0; pass < N_PASSES; pass++) {
+      EdiRowsFunc luma = luma_rows[pass];
+
+      if ((!luma && pass != chroma_pass) || n_dirty == 0)
+        continue;
+
+      if (incremental) {
+        int spread = halo * n_later[pass];
+
+        for (r = 0; r < n_dirty; r++) {
+          wide[r].j0 = MAX (dirty[r].j0 - spread, 0);
+          wide[r].j1 = MIN (dirty[r].j1 + spread, in->height[0]);
+        }
+      }
+
+      for (i = 0; i < n_threads; i++) {
+        bands[i].src = in;
+        bands[i].dest = out;
+        bands[i].phases = out == dest ? phases : NULL;
+        bands[i].luma = luma;
+        bands[i].chroma = pass == chroma_pass ? chroma : NULL;
+        bands[i].rows = wide;
+        bands[i].n_rows = n_dirty;
+        bands[i].dir_map = dirs && out == dest && pass == dirs_pass ?
+            params->dir_map : NULL;
+        bands[i].dir_counts = counting && out == dest &&
+            pass == dirs_pass ? upsampler->row_counts : NULL;
+        /* each band pads its rows once the last pass has written them */
+        bands[i].padding = out == dest && pass == last_pass ?
+            params->padding : 0;
+      }
+      edi_runner_run (upsampler->runner, run_band, band_data);
+    }
+
+    in = out;
+  }
+
+  /* the rows copied from prev_dest are in save_dest already */
+  if (params->save_dest && !phases)
+    save_rows (params->save_dest, dest, dirty, n_dirty, 2);
+
+  if (counting) {
+    for (r = 0; r < last_height - 1; r++) {
+      for (m = 0; m < EDI_DIR_MAP_N_CODES; m++)
+        params->dir_counts[m] +=
+            upsampler->row_counts[EDI_DIR_MAP_N_CODES * r + m];
+    }
+  }
+}
+
+/* The part of src from x0, y0 on, of width x height luma pixels, which
+ * are multiples of the subsampling unless the part ends with src. */
+static void
+sub_image (EdiImage * img, const EdiImage * src, int x0, int y0,
+    int width, int height)
+{
+  int k;
+
+  *img = *src;
+  for (k = 0; k < src->n_components; k++) {
+    int x_shift = src->x_shift[k];
+    int y_shift = src->y_shift[k];
+
+    img->data[k] += src->stride[k] * (y0 >> y_shift) +
+        src->pstride[k] * (x0 >> x_shift);
+    img->width[k] = (width + (1 << x_shift) - 1) >> x_shift;
+    img->height[k] = (height + (1 << y_shift) - 1) >> y_shift;
+  }
+}
+
+/* Upsamples the region of interest of params together with the HALO it
+ * depends on in every stage, which the 2x steps of a cascade shrink to
+ * less than twice that of one, into the roi scratch, and copies the
+ * region out of it. */
+static void
+run_roi (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src, const EdiImage * dest)
+{
+  EdiParams p = *params;
+  EdiImage part, out;
+  int n_stages = params->n_stages;
+  int bps = src->depth > 8 ? 2 : 1;
+  int size = bps * src->channels;
+  int x0, y0, x1, y1, halo, align, shift = 0;
+  gsize scratch_size;
+  int i, j, k;
+
+  for (k = 0; k < src->n_components; k++)
+    shift = MAX (shift, MAX (src->x_shift[k], src->y_shift[k]));
+  align = 1 << shift;
+  halo = 2 * HALO << shift;
+  x0 = MAX (params->roi_x - halo, 0) & ~(align - 1);
+  y0 = MAX (params->roi_y - halo, 0) & ~(align - 1);
+  x1 = MIN (params->roi_x + params->roi_width + halo, src->width[0]);
+  y1 = MIN (params->roi_y + params->roi_height + halo, src->height[0]);
+  if (x1 < src->width[0])
+    x1 = (x1 + align - 1) & ~(align - 1);
+  if (y1 < src->height[0])
+    y1 = (y1 + align - 1) & ~(align - 1);
+
+  sub_image (&part, src, x0, y0, x1 - x0, y1 - y0);
+  scratch_size = image_scratch (&out, &part, n_stages, bps, NULL);
+  if (upsampler->roi_scratch_size < scratch_size) {
+    g_free (upsampler->roi_scratch);
+    upsampler->roi_scratch = g_malloc (scratch_size);
+    upsampler->roi_scratch_size = scratch_size;
+  }
+  image_scratch (&out, &part, n_stages, bps, upsampler->roi_scratch);
+
+  p.prev_src = NULL;
+  p.prev_dest = NULL;
+  p.save_dest = NULL;
+  p.dir_map = NULL;
+  p.padding = 0;
+  p.roi_width = 0;
+  upsampler_run (upsampler, &p, &part, &out, NULL);
+  /* the scratch images now hold the cascade of the part */
+  upsampler->have_last = FALSE;
+
+  for (k = 0; k < dest->n_components; k++) {
+    int x = ((params->roi_x - x0) << n_stages) >> dest->x_shift[k];
+    int y = ((params->roi_y - y0) << n_stages) >> dest->y_shift[k];
+    guint8 *s = out.data[k] + out.stride[k] * y + out.pstride[k] * x;
+
+    for (j = 0; j < dest->height[k]; j++) {
+      guint8 *d = dest->data[k] + dest->stride[k] * j;
+
+      if (dest->pstride[k] == size) {
+        memcpy (d, s, dest->width[k] * size);
+      } else {
+        for (i = 0; i < dest->width[k]; i++)
+          memcpy (d + dest->pstride[k] * i, s + size * i, size);
+      }
+      s += out.stride[k];
+    }
+    if (params->padding > 0)
+      pad_rows (dest, k, 0, dest->height[k], params->padding);
+  }
+}
+
+void
+edi_upsampler_run (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src, const EdiImage * dest)
+{
+  int width = src->width[0], height = src->height[0];
+
+  g_return_if_fail (params->n_stages >= 1);
+  g_return_if_fail (params->padding >= 0);
+  if (params->roi_width > 0) {
+    g_return_if_fail (params->roi_x >= 0 && params->roi_y >= 0);
+    g_return_if_fail (params->roi_height > 0);
+    g_return_if_fail (params->roi_x + params->roi_width <= width);
+    g_return_if_fail (params->roi_y + params->roi_height <= height);
+    width = params->roi_width;
+    height = params->roi_height;
+  }
+  g_return_if_fail (image_fits (dest, src, width << params->n_stages,
+          height << params->n_stages));
+
+  if (params->roi_width > 0)
+    run_roi (upsampler, params, src, dest);
+  else
+    upsampler_run (upsampler, params, src, dest, NULL);
+}
+
+void
+edi_upsampler_run_phases (EdiUpsampler * upsampler,
+    const EdiParams * params, const EdiImage * src,
+    const EdiImage phases[3])
+{
+  int m;
+
+  g_return_if_fail (params->n_stages == 1);
+  g_return_if_fail (params->padding == 0);
+  g_return_if_fail (params->roi_width == 0);
+  for (m = 0; m < 3; m++) {
+    g_return_if_fail (image_fits (&phases[m], src, src->width[0],
+            src->height[0]));
+  }
+
+  upsampler_run (upsampler, params, src, NULL, phases);
+}
+
+void
+edi_upsampler_deinterlace (EdiUpsampler * upsampler,
+    const EdiParams * params, const EdiImage * src, int field,
+    const EdiImage * dest)
+{
+  const EdiMethodRows *rows;
+  EdiRows pairs;
+  EdiBand *bands;
+  gpointer *band_data;
+  guint n_threads = edi_runner_get_n_threads (upsampler->runner);
+  guint i;
+
+  rows = (src->depth > 8 ? methods_u16 : methods_u8) + params->method;
+  g_return_if_fail (rows->field_luma != NULL);
+  g_return_if_fail (field == 0 || field == 1);
+  g_return_if_fail (params->padding >= 0);
+  g_return_if_fail (image_fits (dest, src, src->width[0], src->height[0]));
+
+  /* The bands split the output into pairs of rows, like the 2x rows of a
+   * source row, so that chroma and padding follow the same way. */
+  pairs.j0 = 0;
+  pairs.j1 = (src->height[0] + 1) / 2;
+
+  bands = g_newa (EdiBand, n_threads);
+  band_data = g_newa (gpointer, n_threads);
+  for (i = 0; i < n_threads; i++) {
+    memset (&bands[i], 0, sizeof (EdiBand));
+    bands[i].src = src;
+    bands[i].dest = dest;
+    bands[i].luma = rows->field_luma;
+    bands[i].chroma = rows->field_chroma;
+    bands[i].padding = params->padding;
+    bands[i].rows = &pairs;
+    bands[i].n_rows = 1;
+    bands[i].index = i;
+    bands[i].n_bands = n_threads;
+    bands[i].field = field;
+    band_data[i] = &bands[i];
+  }
+  edi_runner_run (upsampler->runner, run_band, band_data);
+}
+
+gboolean
+edi_can_deinterlace (EdiMethod method)
+{
+  return methods_u8[method].field_luma != NULL;
+}
+
+void
+edi_upsample_plane (EdiMethod method, const guint8 * src, int src_stride,
+    int width, int height, guint8 * dest, int dest_stride)
+{
+  EdiUpsampler *upsampler;
+  EdiParams params = { 0, };
+  EdiImage in = { 0, }, out;
+
+  in.n_components = 1;
+  in.channels = 1;
+  in.depth = 8;
+  in.data[0] = (guint8 *) src;
+  in.stride[0] = src_stride;
+  in.pstride[0] = 1;
+  in.width[0] = width;
+  in.height[0] = height;
+
+  out = in;
+  out.data[0] = dest;
+  out.stride[0] = dest_stride;
+  out.width[0] = 2 * width;
+  out.height[0] = 2 * height;
+
+  params.method = method;
+  params.n_stages = 1;
+
+  upsampler = edi_upsampler_new (1);
+  edi_upsampler_run (upsampler, &params, &in, &out);
+  edi_upsampler_free (upsampler);
+}
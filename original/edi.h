@@ -0,0 +1,169 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _EDI_H_
+#define _EDI_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* The upsampling of the ediupsample element, without GStreamer: edi.c,
+ * edirows.h, edisimd.c and edirunner.c only need GLib. */
+
+typedef enum {
+  EDI_METHOD_CGAK,
+  EDI_METHOD_BILINEAR,
+  EDI_METHOD_DIRAC,
+  EDI_METHOD_EDI_HV,
+  EDI_METHOD_EDI_VH,
+  EDI_METHOD_DAALA
+} EdiMethod;
+
+typedef enum {
+  EDI_CHROMA_MODE_BILINEAR,
+  EDI_CHROMA_MODE_LUMA_GUIDED
+} EdiChromaMode;
+
+/* A picture of up to three components, luma first.  Strides and pixel
+ * strides are in bytes.  Samples are 8 bit, or 16 bit in host order
+ * when depth is more than 8.  x_shift and y_shift are the subsampling of
+ * each component.  Packed RGB is a single component of four channels,
+ * with R, G and B at rgb_offset bytes into a pixel. */
+typedef struct
+{
+  int n_components;
+  int channels;
+  int depth;
+  guint8 *data[3];
+  int stride[3];
+  int pstride[3];
+  int width[3];
+  int height[3];
+  int x_shift[3];
+  int y_shift[3];
+  int rgb_offset[3];
+} EdiImage;
+
+/* The codes of the direction map, 4 bits per output luma pixel with the
+ * even column in the low nibble: EDI_DIR_MAP_SOURCE for source pixels,
+ * including the copies of them that fill the last column and the last
+ * two rows, EDI_DIR_MAP_FLAT + d for pixels interpolated along CGAK
+ * direction d (see edisimd.h). */
+#define EDI_DIR_MAP_SOURCE 0
+#define EDI_DIR_MAP_FLAT 6
+#define EDI_DIR_MAP_N_CODES 12
+
+typedef struct
+{
+  EdiMethod method;
+  EdiChromaMode chroma_mode;
+  /* upsample by 1 << n_stages, as a cascade of 2x steps */
+  int n_stages;
+  /* where to store the direction map of the output, cgak only, or NULL */
+  guint8 *dir_map;
+  int dir_map_stride;
+  /* The previous picture and its output from the last run of the same
+   * upsampler with the same params, or NULL.  Output rows that only
+   * depend on unchanged source rows are then copied from prev_dest
+   * rather than upsampled again, with the same result.  Not used along
+   * with a dir_map. */
+  const EdiImage *prev_src;
+  const EdiImage *prev_dest;
+  /* Where to also copy the output, for the next run's prev_dest, or
+   * NULL.  It has the size of dest, without the padding, and must be
+   * prev_dest when that is given, as then only the rows upsampled again
+   * are copied.  edi_upsampler_run() only, not along with a region of
+   * interest. */
+  const EdiImage *save_dest;
+  /* A border of padding pixels around the output, filled with its edge
+   * pixels as they are written, for motion compensation references.
+   * Components subsampled by x_shift and y_shift get padding >> x_shift
+   * pixels left and right and padding >> y_shift rows above and below,
+   * which dest must have room for. */
+  int padding;
+  /* Where to add how many interpolated luma pixels of the output took
+   * each CGAK direction, indexed by the codes of the direction map, or
+   * NULL.  cgak only; incrementally, the rows copied from prev_dest count
+   * as they did the last time. */
+  guint64 *dir_counts;
+  /* Unless roi_width is 0, only the rectangle of roi_width x roi_height
+   * luma pixels at roi_x, roi_y of src is upsampled, into a dest of that
+   * size.  Its output is the same as that part of the whole picture's,
+   * at a cost that follows the area of the rectangle.  prev_src,
+   * prev_dest and dir_map are not used along with it, and dir_counts
+   * also counts the rows and columns read around the rectangle. */
+  int roi_x;
+  int roi_y;
+  int roi_width;
+  int roi_height;
+} EdiParams;
+
+/* Keeps the threads and buffers of upsampling from one picture to the
+ * next.  A number of threads of 0 means one per processor. */
+typedef struct _EdiUpsampler EdiUpsampler;
+
+EdiUpsampler *edi_upsampler_new (guint n_threads);
+void edi_upsampler_free (EdiUpsampler * upsampler);
+void edi_upsampler_set_n_threads (EdiUpsampler * upsampler, guint n_threads);
+guint edi_upsampler_get_n_threads (EdiUpsampler * upsampler);
+
+/* Upsamples src into dest.  dest has the layout of src at 1 << n_stages
+ * times the luma size of src, or of the region of interest, with its
+ * subsampled components rounded up from that like in GStreamer: those of
+ * an odd-sized dest are one pixel short of twice those of src. */
+void edi_upsampler_run (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src, const EdiImage * dest);
+
+/* Upsamples by 2 in one stage like edi_upsampler_run(), but only stores
+ * the interpolated pixels, as three images the size of src: phases[0]
+ * gets the pixels right of the source pixels (H), phases[1] those below
+ * them (V) and phases[2] those below and right (D).  params->prev_dest is
+ * then the three phases of the last run, and params->padding and
+ * params->roi_width must be 0. */
+void edi_upsampler_run_phases (EdiUpsampler * upsampler,
+    const EdiParams * params, const EdiImage * src,
+    const EdiImage phases[3]);
+
+/* Deinterlaces src, a frame of two interleaved fields, into dest of the
+ * same size as a picture of one of them: the rows of field, 0 for the
+ * top one and 1 for the bottom one, are kept and those of the other
+ * rebuilt between the field rows above and below.  cgak interpolates
+ * the luma along the CGAK directions it finds there, without a
+ * horizontal pass, and bilinear averages; no other method can.  Only
+ * params->method and params->padding are used. */
+void edi_upsampler_deinterlace (EdiUpsampler * upsampler,
+    const EdiParams * params, const EdiImage * src, int field,
+    const EdiImage * dest);
+
+/* Whether edi_upsampler_deinterlace() can use method. */
+gboolean edi_can_deinterlace (EdiMethod method);
+
+/* Upsamples one 8 bit plane of width x height by 2 on the calling
+ * thread.  dest must hold 2 * width x 2 * height samples. */
+void edi_upsample_plane (EdiMethod method, const guint8 * src,
+    int src_stride, int width, int height, guint8 * dest, int dest_stride);
+
+/* The name of the vector kernels in use on this CPU. */
+const gchar *edi_get_simd_name (void);
+
+G_END_DECLS
+
+#endif
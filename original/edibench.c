@@ -0,0 +1,354 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Throughput of the edi library, without a pipeline around it.
+ *
+ *   make edibench
+ *
+ * For every method, content and input size it upsamples an I420 picture
+ * by 2 and prints one line per path: "luma" is the Y plane alone,
+ * "chroma" the rest of the frame, and "frame" all of it.  Rates are in
+ * output pixels of the path, from the median of the timed runs; cycles
+ * are TSC ticks. */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "edi.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+typedef struct
+{
+  const gchar *name;
+  /* NULL for the synthetic patterns */
+  const gchar *file;
+} Content;
+
+static const Content contents[] = {
+  {"noise", NULL},
+  {"zoneplate", NULL},
+  {"kitten", "kitten.png"},
+  {"rays", "rays.png"},
+  {"checkerboard", "checkerboard.png"},
+};
+
+static const struct
+{
+  int width, height;
+} sizes[] = {
+  {320, 240},
+  {640, 480},
+  {1280, 720},
+  {1920, 1080},
+  {3840, 2160},
+};
+
+static const struct
+{
+  const gchar *name;
+  EdiMethod method;
+  EdiChromaMode chroma_mode;
+} methods[] = {
+  {"cgak", EDI_METHOD_CGAK, EDI_CHROMA_MODE_BILINEAR},
+  {"cgak-guided", EDI_METHOD_CGAK, EDI_CHROMA_MODE_LUMA_GUIDED},
+  {"bilinear", EDI_METHOD_BILINEAR, EDI_CHROMA_MODE_BILINEAR},
+  {"dirac", EDI_METHOD_DIRAC, EDI_CHROMA_MODE_BILINEAR},
+  {"edi-hv", EDI_METHOD_EDI_HV, EDI_CHROMA_MODE_BILINEAR},
+  {"edi-vh", EDI_METHOD_EDI_VH, EDI_CHROMA_MODE_BILINEAR},
+  {"daala", EDI_METHOD_DAALA, EDI_CHROMA_MODE_BILINEAR},
+};
+
+static gint n_warmup = 3;
+static gint n_runs = 15;
+static gint n_threads = 1;
+static gint max_size = 3840;
+static gchar *content_dir = (gchar *) ".";
+static gchar *only_method = NULL;
+
+static GOptionEntry entries[] = {
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &n_warmup,
+      "Untimed runs before measuring", "N"},
+  {"runs", 'r', 0, G_OPTION_ARG_INT, &n_runs, "Timed runs", "N"},
+  {"threads", 't', 0, G_OPTION_ARG_INT, &n_threads,
+      "Threads (0 = number of processors)", "N"},
+  {"max-width", 's', 0, G_OPTION_ARG_INT, &max_size,
+      "Skip input sizes wider than this", "WIDTH"},
+  {"content-dir", 'd', 0, G_OPTION_ARG_FILENAME, &content_dir,
+      "Where kitten.png, rays.png and checkerboard.png are", "DIR"},
+  {"method", 'm', 0, G_OPTION_ARG_STRING, &only_method,
+      "Only run this method", "NAME"},
+  {NULL}
+};
+
+/* An I420 picture in one allocation, as three EdiImage components. */
+static guint8 *
+picture_new (EdiImage * img, int width, int height)
+{
+  guint8 *data;
+  int k;
+
+  memset (img, 0, sizeof (*img));
+  img->n_components = 3;
+  img->channels = 1;
+  img->depth = 8;
+  for (k = 0; k < 3; k++) {
+    img->x_shift[k] = img->y_shift[k] = k > 0;
+    img->width[k] = (width + img->x_shift[k]) >> img->x_shift[k];
+    img->height[k] = (height + img->y_shift[k]) >> img->y_shift[k];
+    img->stride[k] = (img->width[k] + 31) & ~31;
+    img->pstride[k] = 1;
+  }
+
+  data = g_malloc (img->stride[0] * img->height[0] +
+      2 * img->stride[1] * img->height[1]);
+  img->data[0] = data;
+  img->data[1] = img->data[0] + img->stride[0] * img->height[0];
+  img->data[2] = img->data[1] + img->stride[1] * img->height[1];
+
+  return data;
+}
+
+static void
+fill_synthetic (EdiImage * img, const gchar * name)
+{
+  int i, j, k;
+
+  for (k = 0; k < 3; k++) {
+    for (j = 0; j < img->height[k]; j++) {
+      guint8 *d = img->data[k] + img->stride[k] * j;
+
+      for (i = 0; i < img->width[k]; i++) {
+        if (strcmp (name, "noise") == 0) {
+          d[i] = g_random_int_range (0, 256);
+        } else {
+          /* a zone plate: edges at every angle and frequency */
+          int x = i - img->width[k] / 2;
+          int y = j - img->height[k] / 2;
+
+          d[i] = 128 + 127 * sin ((x * x + y * y) * (k + 1) * 0.002);
+        }
+      }
+    }
+  }
+}
+
+/* Converts pixbuf to BT.709 YCbCr and tiles it over img. */
+static void
+fill_pixbuf (EdiImage * img, GdkPixbuf * pixbuf)
+{
+  const guint8 *pixels = gdk_pixbuf_get_pixels (pixbuf);
+  int rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  int n_channels = gdk_pixbuf_get_n_channels (pixbuf);
+  int pw = gdk_pixbuf_get_width (pixbuf);
+  int ph = gdk_pixbuf_get_height (pixbuf);
+  int i, j, k;
+
+  for (k = 0; k < 3; k++) {
+    for (j = 0; j < img->height[k]; j++) {
+      guint8 *d = img->data[k] + img->stride[k] * j;
+
+      for (i = 0; i < img->width[k]; i++) {
+        const guint8 *s = pixels +
+            rowstride * ((j << img->y_shift[k]) % ph) +
+            n_channels * ((i << img->x_shift[k]) % pw);
+        int r = s[0], g = s[1], b = s[2];
+        int v;
+
+        if (k == 0)
+          v = (47 * r + 157 * g + 16 * b + 128) / 256 + 16;
+        else if (k == 1)
+          v = (-26 * r - 87 * g + 112 * b + 128) / 256 + 128;
+        else
+          v = (112 * r - 102 * g - 10 * b + 128) / 256 + 128;
+        d[i] = CLAMP (v, 0, 255);
+      }
+    }
+  }
+}
+
+static int
+compare_double (gconstpointer a, gconstpointer b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* Runs the upsampler over in and returns the median time of a run in
+ * seconds, and in *cycles its TSC ticks, or 0 where there is no TSC. */
+static double
+measure (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * in, const EdiImage * out, double *cycles)
+{
+  double *times = g_new (double, n_runs);
+  double *ticks = g_new (double, n_runs);
+  double median;
+  int r;
+
+  for (r = 0; r < n_warmup; r++)
+    edi_upsampler_run (upsampler, params, in, out);
+
+  for (r = 0; r < n_runs; r++) {
+    gint64 start = g_get_monotonic_time ();
+#ifdef HAVE_RDTSC
+    guint64 tsc = __rdtsc ();
+#endif
+
+    edi_upsampler_run (upsampler, params, in, out);
+
+#ifdef HAVE_RDTSC
+    ticks[r] = __rdtsc () - tsc;
+#else
+    ticks[r] = 0;
+#endif
+    times[r] = (g_get_monotonic_time () - start) * 1e-6;
+  }
+
+  qsort (times, n_runs, sizeof (double), compare_double);
+  qsort (ticks, n_runs, sizeof (double), compare_double);
+  median = times[n_runs / 2];
+  *cycles = ticks[n_runs / 2];
+
+  g_free (times);
+  g_free (ticks);
+  return median;
+}
+
+static void
+report (const gchar * method, const gchar * path, const gchar * content,
+    int width, int height, gsize n_pixels, double seconds, double cycles)
+{
+  g_print ("%-12s %-7s %-13s %4dx%-5d %9.1f %9.3f", method, path, content,
+      width, height, n_pixels / seconds * 1e-6, seconds * 1e9 / n_pixels);
+  if (cycles > 0)
+    g_print (" %9.2f\n", cycles / n_pixels);
+  else
+    g_print (" %9s\n", "-");
+}
+
+static void
+bench (EdiUpsampler * upsampler, int m, const gchar * content,
+    const EdiImage * in, const EdiImage * out)
+{
+  EdiParams params = { 0, };
+  EdiImage luma_in = *in, luma_out = *out;
+  gsize luma_pixels = (gsize) out->width[0] * out->height[0];
+  gsize chroma_pixels = 2 * (gsize) out->width[1] * out->height[1];
+  double luma_time, frame_time, luma_cycles, frame_cycles;
+
+  params.method = methods[m].method;
+  params.chroma_mode = methods[m].chroma_mode;
+  params.n_stages = 1;
+
+  luma_in.n_components = luma_out.n_components = 1;
+  luma_time = measure (upsampler, &params, &luma_in, &luma_out, &luma_cycles);
+  frame_time = measure (upsampler, &params, in, out, &frame_cycles);
+
+  report (methods[m].name, "luma", content, in->width[0], in->height[0],
+      luma_pixels, luma_time, luma_cycles);
+  /* the frame without its luma; guided chroma also waits for it */
+  report (methods[m].name, "chroma", content, in->width[0], in->height[0],
+      chroma_pixels, MAX (frame_time - luma_time, 1e-9),
+      MAX (frame_cycles - luma_cycles, 0));
+  report (methods[m].name, "frame", content, in->width[0], in->height[0],
+      luma_pixels + chroma_pixels, frame_time, frame_cycles);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  EdiUpsampler *upsampler;
+  guint c, s, m;
+
+  ctx = g_option_context_new ("- benchmark the edi upsampling methods");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (ctx);
+  if (n_runs < 1 || n_warmup < 0 || n_threads < 0) {
+    g_printerr ("invalid number of runs or threads\n");
+    return 1;
+  }
+
+  upsampler = edi_upsampler_new (n_threads);
+  g_print ("# %s kernels, %u threads, %d warm-up and %d timed runs\n",
+      edi_get_simd_name (), edi_upsampler_get_n_threads (upsampler),
+      n_warmup, n_runs);
+  g_print ("%-12s %-7s %-13s %-10s %9s %9s %9s\n", "# method", "path",
+      "content", "input", "Mpix/s", "ns/pix", "cyc/pix");
+
+  for (c = 0; c < G_N_ELEMENTS (contents); c++) {
+    GdkPixbuf *pixbuf = NULL;
+
+    if (contents[c].file) {
+      gchar *path = g_build_filename (content_dir, contents[c].file, NULL);
+
+      pixbuf = gdk_pixbuf_new_from_file (path, &error);
+      g_free (path);
+      if (!pixbuf) {
+        g_printerr ("skipping %s: %s\n", contents[c].name, error->message);
+        g_clear_error (&error);
+        continue;
+      }
+    }
+
+    for (s = 0; s < G_N_ELEMENTS (sizes); s++) {
+      EdiImage in, out;
+      guint8 *in_data, *out_data;
+
+      if (sizes[s].width > max_size)
+        continue;
+
+      in_data = picture_new (&in, sizes[s].width, sizes[s].height);
+      out_data = picture_new (&out, 2 * sizes[s].width,
+          2 * sizes[s].height);
+      if (pixbuf)
+        fill_pixbuf (&in, pixbuf);
+      else
+        fill_synthetic (&in, contents[c].name);
+
+      for (m = 0; m < G_N_ELEMENTS (methods); m++) {
+        if (only_method && strcmp (only_method, methods[m].name) != 0)
+          continue;
+        bench (upsampler, m, contents[c].name, &in, &out);
+      }
+
+      g_free (in_data);
+      g_free (out_data);
+    }
+
+    if (pixbuf)
+      g_object_unref (pixbuf);
+  }
+
+  edi_upsampler_free (upsampler);
+  return 0;
+}
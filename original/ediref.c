@@ -0,0 +1,685 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The transform_frame functions of the element before the edi library,
+ * one plane at a time, on 16 bit samples and with the direction of each
+ * CGAK gap written down.  The chroma no longer reads one sample past the
+ * end of the row in its last column, which repeats itself instead.
+ *
+ * daala, edi-hv and edi-vh are daala(), edi_hv() and edi_vh() of main.js
+ * over the picture area, upsampling the whole picture one step after
+ * the other.  main.js reads past the picture into padding that repeats
+ * the edge pixels; here the indices are clamped instead, which comes to
+ * the same for pictures a few pixels across and defines the smaller
+ * ones. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "ediref.h"
+
+#define MARGIN 3
+
+/* The weights of the taps of each CGAK direction, by its absolute value;
+ * 0 for flat areas, where the average of the two pixels is the same as
+ * that of direction 1. */
+static const int weights[6][4] = {
+  {0, 0, 0, 16},
+  {0, 0, 0, 16},
+  {0, 0, 8, 8},
+  {0, 4, 8, 4},
+  {1, 7, 7, 1},
+  {4, 8, 4, 0},
+};
+
+/* The CGAK direction of a gap from its gradients, negative when dx < 0
+ * once dy is made positive. */
+static int
+direction (int dx, int dy, int dx2)
+{
+  if (dy < 0) {
+    dy = -dy;
+    dx = -dx;
+  }
+
+  if (ABS (dx) <= 4 * ABS (dx2)) {
+    return 0;
+  } else if (dx < 0) {
+    if (dx < -2 * dy) {
+      return -1;
+    } else if (dx < -dy) {
+      return -2;
+    } else if (2 * dx < -dy) {
+      return -3;
+    } else if (3 * dx < -dy) {
+      return -4;
+    } else {
+      return -5;
+    }
+  } else {
+    if (dx > 2 * dy) {
+      return 1;
+    } else if (dx > dy) {
+      return 2;
+    } else if (2 * dx > dy) {
+      return 3;
+    } else if (3 * dx > dy) {
+      return 4;
+    } else {
+      return 5;
+    }
+  }
+}
+
+/* Interpolates between src[0] and src[1] along direction n, the taps on
+ * the left from the rows above when n < 0 and from those below
+ * otherwise. */
+static int
+reconstruct_v (const guint16 * src, int stride, int n)
+{
+  const int *w = weights[ABS (n)];
+  int x;
+
+  if (n >= 0)
+    stride = -stride;
+  x = src[0 - 3 * stride] * w[0];
+  x += src[0 - 2 * stride] * w[1];
+  x += src[0 - 1 * stride] * w[2];
+  x += src[0 - 0 * stride] * w[3];
+  x += src[1 + 0 * stride] * w[3];
+  x += src[1 + 1 * stride] * w[2];
+  x += src[1 + 2 * stride] * w[1];
+  x += src[1 + 3 * stride] * w[0];
+  return (x + 16) >> 5;
+}
+
+/* Interpolates between the pixels d1[0] and d3[0] of two lines along
+ * direction n, the taps on the left from d1 when n < 0 and from d3
+ * otherwise. */
+static int
+reconstruct_h (const guint16 * d1, const guint16 * d3, int n)
+{
+  const int *w = weights[ABS (n)];
+  const guint16 *a = n < 0 ? d1 : d3;
+  const guint16 *b = n < 0 ? d3 : d1;
+  int x;
+
+  x = a[-3] * w[0];
+  x += a[-2] * w[1];
+  x += a[-1] * w[2];
+  x += a[-0] * w[3];
+  x += b[0] * w[3];
+  x += b[1] * w[2];
+  x += b[2] * w[1];
+  x += b[3] * w[0];
+  return (x + 16) >> 5;
+}
+
+/* The second CGAK pass: interpolates the line d2 of width pixels between
+ * d1 and d3, writing the direction of each pixel to dir unless it is
+ * NULL. */
+static void
+cgak_line (const guint16 * d1, const guint16 * d3, int width, int max,
+    guint16 * d2, gint8 * dir)
+{
+  int i;
+
+  for (i = 0; i < width; i++) {
+    int n = 0, v;
+
+    if (i >= MARGIN && i < width - MARGIN - 1) {
+      int dx, dy, dx2;
+
+      dx = -d1[i - 1]
+          - d3[i - 1]
+          + d1[i + 1]
+          + d3[i + 1];
+      dx *= 2;
+
+      dy = -d1[i - 1]
+          - 2 * d1[i]
+          - d1[i + 1]
+          + d3[i - 1]
+          + 2 * d3[i]
+          + d3[i + 1];
+
+      dx2 = -d1[i - 1]
+          + 2 * d1[i]
+          - d1[i + 1]
+          - d3[i - 1]
+          + 2 * d3[i]
+          - d3[i + 1];
+
+      n = direction (dx, dy, dx2);
+      v = reconstruct_h (d1 + i, d3 + i, n);
+    } else {
+      v = (d1[i] + d3[i] + 1) >> 1;
+    }
+    d2[i] = CLAMP (v, 0, max);
+    if (dir)
+      dir[i] = n;
+  }
+}
+
+static void
+cgak (const guint16 * src, int src_width, int src_height, int max,
+    guint16 * dest, gint8 * dir_h, gint8 * dir_v)
+{
+  int src_stride = src_width;
+  int dest_stride = 2 * src_width;
+  int i, j;
+
+  for (j = 0; j < src_height; j++) {
+    const guint16 *s = src + src_stride * j;
+    guint16 *d = dest + dest_stride * 2 * j;
+
+    for (i = 0; i < src_width; i++) {
+      int n = 0, v;
+
+      if (i == src_width - 1) {
+        v = s[i];
+      } else if (j >= MARGIN && j < src_height - MARGIN - 1) {
+        int dx, dy, dx2;
+
+        dx = -s[-src_stride + i]
+            - s[-src_stride + i + 1]
+            + s[src_stride + i]
+            + s[src_stride + i + 1];
+        dx *= 2;
+
+        dy = -s[-src_stride + i]
+            - 2 * s[i]
+            - s[src_stride + i]
+            + s[-src_stride + i + 1]
+            + 2 * s[i + 1]
+            + s[src_stride + i + 1];
+
+        dx2 = -s[-src_stride + i]
+            + 2 * s[i]
+            - s[src_stride + i]
+            - s[-src_stride + i + 1]
+            + 2 * s[i + 1]
+            - s[src_stride + i + 1];
+
+        n = direction (dx, dy, dx2);
+        v = reconstruct_v (s + i, src_stride, n);
+      } else {
+        v = (s[i] + s[i + 1] + 1) >> 1;
+      }
+      d[i * 2] = s[i];
+      d[i * 2 + 1] = CLAMP (v, 0, max);
+      if (dir_h)
+        dir_h[src_width * j + i] = n;
+    }
+  }
+  for (j = 0; j < src_height - 1; j++)
+    cgak_line (dest + dest_stride * 2 * j, dest + dest_stride * (2 * j + 2),
+        dest_stride, max, dest + dest_stride * (2 * j + 1),
+        dir_v ? dir_v + dest_stride * j : NULL);
+  {
+    guint16 *d1 = dest + dest_stride * 2 * j;
+    guint16 *d2 = dest + dest_stride * (2 * j + 1);
+
+    for (i = 0; i < src_width; i++) {
+      d1[2 * i + 1] = d1[i * 2];
+      d2[2 * i] = d1[i * 2];
+      d2[2 * i + 1] = d1[i * 2];
+    }
+    if (dir_v)
+      memset (dir_v + dest_stride * j, 0, dest_stride);
+  }
+}
+
+static int
+dirac_filter (int s0, int s1, int s2, int s3, int s4, int s5, int s6,
+    int s7, int max)
+{
+  int v;
+
+  v = -1 * s0 + 3 * s1 + -7 * s2 + 21 * s3 + 21 * s4 + -7 * s5 + 3 * s6
+      + -1 * s7;
+  v = (v + 16) >> 5;
+  return CLAMP (v, 0, max);
+}
+
+static void
+dirac (const guint16 * s0, int src_width, int src_height, int max,
+    guint16 * dest)
+{
+  int dest_stride = 2 * src_width;
+  int last = src_width - 1;
+  int i, j;
+
+  for (j = 0; j < src_height; j++) {
+    const guint16 *s = s0 + src_width * j;
+    guint16 *d = dest + dest_stride * 2 * j;
+
+    for (i = 0; i < src_width; i++) {
+      d[i * 2] = s[i];
+      d[i * 2 + 1] = dirac_filter (s[CLAMP (i - 3, 0, last)],
+          s[CLAMP (i - 2, 0, last)], s[CLAMP (i - 1, 0, last)],
+          s[CLAMP (i, 0, last)], s[CLAMP (i + 1, 0, last)],
+          s[CLAMP (i + 2, 0, last)], s[CLAMP (i + 3, 0, last)],
+          s[CLAMP (i + 4, 0, last)], max);
+    }
+  }
+  for (j = 0; j < src_height; j++) {
+    guint16 *d = dest + dest_stride * (2 * j + 1);
+    const guint16 *e[8];
+    int k;
+
+    /* the even lines around the gap, repeating the first and last */
+    for (k = 0; k < 8; k++)
+      e[k] = dest + dest_stride * 2 * CLAMP (j + k - 3, 0, src_height - 1);
+    for (i = 0; i < src_width * 2; i++) {
+      d[i] = dirac_filter (e[0][i], e[1][i], e[2][i], e[3][i], e[4][i],
+          e[5][i], e[6][i], e[7][i], max);
+    }
+  }
+}
+
+static void
+bilinear (const guint16 * src, int src_width, int src_height,
+    guint16 * dest)
+{
+  int dest_stride = 2 * src_width;
+  int i, j;
+
+  for (j = 0; j < src_height; j++) {
+    const guint16 *s = src + src_width * j;
+    guint16 *d = dest + dest_stride * 2 * j;
+
+    for (i = 0; i < src_width; i++) {
+      d[i * 2] = s[i];
+      if (i < src_width - 1)
+        d[i * 2 + 1] = (s[i] + s[i + 1] + 1) >> 1;
+      else
+        d[i * 2 + 1] = s[i];
+    }
+  }
+  for (j = 0; j < src_height; j++) {
+    guint16 *d = dest + dest_stride * (2 * j + 1);
+
+    for (i = 0; i < src_width * 2; i++) {
+      if (j < src_height - 1)
+        d[i] = (d[i - dest_stride] + d[i + dest_stride] + 1) >> 1;
+      else
+        d[i] = d[i - dest_stride];
+    }
+  }
+}
+
+/* Daala's six-tap half-pixel filter, (1 -5 20 20 -5 1) / 32, between c
+ * and d. */
+static int
+sixtap (int a, int b, int c, int d, int e, int f, int max)
+{
+  int v = (a - 5 * b + 20 * c + 20 * d - 5 * e + f + 16) >> 5;
+
+  return CLAMP (v, 0, max);
+}
+
+/* One side of the six-tap filter, as the taps of the edge directed ones:
+ * a the sample next to the gap, b and c further out. */
+static int
+sinc (int a, int b, int c)
+{
+  return 20 * a - 5 * b + c;
+}
+
+/* Upsamples the row s of width samples into d with the six-tap filter,
+ * repeating the end samples. */
+static void
+sixtap_row (const guint16 * s, int width, int max, guint16 * d)
+{
+  int last = width - 1;
+  int i;
+
+  for (i = 0; i < width; i++) {
+    d[2 * i] = s[i];
+    d[2 * i + 1] = sixtap (s[MAX (i - 2, 0)], s[MAX (i - 1, 0)], s[i],
+        s[MIN (i + 1, last)], s[MIN (i + 2, last)], s[MIN (i + 3, last)],
+        max);
+  }
+}
+
+/* The gap right of sample i of the row l[3], of width samples, along the
+ * CGAK direction of the rows l[2] to l[4], with the seven rows l[0] to
+ * l[6] taking one side of the six-tap filter as the taps.  Columns past
+ * either end repeat the end sample. */
+static int
+sinc_gap_h (const guint16 ** l, int width, int i, int max)
+{
+  int last = width - 1;
+  int c[6];
+  const guint16 *up = l[2], *s = l[3], *down = l[4];
+  int k, n, v;
+
+  for (k = 0; k < 6; k++)
+    c[k] = CLAMP (i + k - 2, 0, last);
+  n = direction (2 * (-up[c[2]] - up[c[3]] + down[c[2]] + down[c[3]]),
+      -up[c[2]] - 2 * s[c[2]] - down[c[2]] + up[c[3]] + 2 * s[c[3]] +
+      down[c[3]],
+      -up[c[2]] + 2 * s[c[2]] - down[c[2]] - up[c[3]] + 2 * s[c[3]] -
+      down[c[3]]);
+  if (n == 0)
+    return sixtap (s[c[0]], s[c[1]], s[c[2]], s[c[3]], s[c[4]], s[c[5]],
+        max);
+
+  v = 0;
+  for (k = 0; k < 4; k++) {
+    const guint16 *a = l[n < 0 ? k : 6 - k];
+    const guint16 *b = l[n < 0 ? 6 - k : k];
+
+    v += weights[ABS (n)][k] * (sinc (a[c[2]], a[c[1]], a[c[0]]) +
+        sinc (b[c[3]], b[c[4]], b[c[5]]));
+  }
+  v = (v + 256) >> 9;
+  return CLAMP (v, 0, max);
+}
+
+/* The gap between sample x of the rows l[2] and l[3] along their CGAK
+ * direction, with the six rows l[0] to l[5] taking one side of the
+ * six-tap filter as the taps.  x must be MARGIN samples from either
+ * end. */
+static int
+sinc_gap_v (const guint16 ** l, int x, int max)
+{
+  const guint16 *d1 = l[2], *d3 = l[3];
+  int k, n, v;
+
+  n = direction (2 * (-d1[x - 1] - d3[x - 1] + d1[x + 1] + d3[x + 1]),
+      -d1[x - 1] - 2 * d1[x] - d1[x + 1] + d3[x - 1] + 2 * d3[x] + d3[x + 1],
+      -d1[x - 1] + 2 * d1[x] - d1[x + 1] - d3[x - 1] + 2 * d3[x] -
+      d3[x + 1]);
+  if (n == 0)
+    return sixtap (l[0][x], l[1][x], d1[x], d3[x], l[4][x], l[5][x], max);
+
+  v = 0;
+  for (k = 0; k < 4; k++) {
+    int xa = x + k - 3, xb = x + 3 - k;
+
+    if (n < 0)
+      v += weights[ABS (n)][k] * (sinc (d1[xa], l[1][xa], l[0][xa]) +
+          sinc (d3[xb], l[4][xb], l[5][xb]));
+    else
+      v += weights[ABS (n)][k] * (sinc (d3[xa], l[4][xa], l[5][xa]) +
+          sinc (d1[xb], l[1][xb], l[0][xb]));
+  }
+  v = (v + 256) >> 9;
+  return CLAMP (v, 0, max);
+}
+
+/* Interpolates the rows between those of the picture h of width x height,
+ * into every other row of dest from the second on: with the six-tap
+ * filter, or along the edges with edge set, but for MARGIN samples from
+ * either end.  Rows past the top and bottom repeat the edge rows. */
+static void
+vertical (const guint16 * h, int width, int height, int max,
+    gboolean edge, guint16 * dest)
+{
+  int x, j, k;
+
+  for (j = 0; j < height; j++) {
+    guint16 *d = dest + width * (2 * j + 1);
+    const guint16 *l[6];
+
+    for (k = 0; k < 6; k++)
+      l[k] = h + width * CLAMP (j + k - 2, 0, height - 1);
+    for (x = 0; x < width; x++) {
+      if (edge && x >= MARGIN && x < width - MARGIN - 1)
+        d[x] = sinc_gap_v (l, x, max);
+      else
+        d[x] = sixtap (l[0][x], l[1][x], l[2][x], l[3][x], l[4][x],
+            l[5][x], max);
+    }
+  }
+}
+
+/* od_state_upsample8() of Daala, the six-tap filter across and down. */
+static void
+daala (const guint16 * src, int width, int height, int max, guint16 * dest)
+{
+  guint16 *h = g_new (guint16, 2 * width * height);
+  int j;
+
+  for (j = 0; j < height; j++) {
+    sixtap_row (src + width * j, width, max, h + 2 * width * j);
+    memcpy (dest + 2 * width * 2 * j, h + 2 * width * j,
+        2 * width * sizeof (guint16));
+  }
+  vertical (h, 2 * width, height, max, FALSE, dest);
+
+  g_free (h);
+}
+
+/* CGAK with six-tap taps, across first: the gaps right of the source
+ * pixels along the edges of the source rows, then those between the rows
+ * along the edges of the result. */
+static void
+edi_hv (const guint16 * src, int width, int height, int max,
+    guint16 * dest)
+{
+  guint16 *h = g_new (guint16, 2 * width * height);
+  int i, j, k;
+
+  for (j = 0; j < height; j++) {
+    const guint16 *s = src + width * j;
+    guint16 *d = h + 2 * width * j;
+
+    if (j < MARGIN || j >= height - MARGIN - 1) {
+      sixtap_row (s, width, max, d);
+    } else {
+      const guint16 *l[7];
+
+      for (k = 0; k < 7; k++)
+        l[k] = s + width * (k - 3);
+      for (i = 0; i < width; i++) {
+        d[2 * i] = s[i];
+        d[2 * i + 1] = sinc_gap_h (l, width, i, max);
+      }
+    }
+    memcpy (dest + 2 * width * 2 * j, d, 2 * width * sizeof (guint16));
+  }
+  vertical (h, 2 * width, height, max, TRUE, dest);
+
+  g_free (h);
+}
+
+/* CGAK with six-tap taps, down first: the lines between the source rows
+ * along the edges, then the gaps right of the pixels of every line along
+ * the edges of the lines around it.  The last line repeats the last row,
+ * and the last gap of a line its last pixel. */
+static void
+edi_vh (const guint16 * src, int width, int height, int max,
+    guint16 * dest)
+{
+  int n_lines = 2 * height;
+  guint16 *v = g_new (guint16, width * n_lines);
+  int i, y, k;
+
+  for (y = 0; y < height; y++)
+    memcpy (v + width * 2 * y, src + width * y, width * sizeof (guint16));
+  vertical (src, width, height, max, TRUE, v);
+  memcpy (v + width * (n_lines - 1), src + width * (height - 1),
+      width * sizeof (guint16));
+
+  for (y = 0; y < n_lines; y++) {
+    const guint16 *s = v + width * y;
+    guint16 *d = dest + 2 * width * y;
+
+    if (y < MARGIN || y >= n_lines - MARGIN - 1) {
+      sixtap_row (s, width, max, d);
+    } else {
+      const guint16 *l[7];
+
+      for (k = 0; k < 7; k++)
+        l[k] = v + width * (y + k - 3);
+      for (i = 0; i < width - 1; i++) {
+        d[2 * i] = s[i];
+        d[2 * i + 1] = sinc_gap_h (l, width, i, max);
+      }
+      d[2 * i] = s[i];
+      d[2 * i + 1] = s[i];
+    }
+  }
+
+  g_free (v);
+}
+
+void
+ediref_upsample (EdiMethod method, const guint16 * src, int width,
+    int height, int max, guint16 * dest, gint8 * dir_h, gint8 * dir_v)
+{
+  switch (method) {
+    case EDI_METHOD_CGAK:
+      cgak (src, width, height, max, dest, dir_h, dir_v);
+      break;
+    case EDI_METHOD_BILINEAR:
+      bilinear (src, width, height, dest);
+      break;
+    case EDI_METHOD_DIRAC:
+      dirac (src, width, height, max, dest);
+      break;
+    case EDI_METHOD_EDI_HV:
+      edi_hv (src, width, height, max, dest);
+      break;
+    case EDI_METHOD_EDI_VH:
+      edi_vh (src, width, height, max, dest);
+      break;
+    case EDI_METHOD_DAALA:
+      daala (src, width, height, max, dest);
+      break;
+    default:
+      g_assert_not_reached ();
+  }
+}
+
+void
+ediref_upsample_chroma (const guint16 * src, int width, int height,
+    guint16 * dest)
+{
+  int dest_stride = 2 * width;
+  int i, j;
+
+  for (j = 0; j < height; j++) {
+    const guint16 *s1 = src + width * j;
+    const guint16 *s2 = j < height - 1 ? s1 + width : s1;
+    guint16 *d1 = dest + dest_stride * 2 * j;
+    guint16 *d2 = dest + dest_stride * (2 * j + 1);
+
+    for (i = 0; i < width; i++) {
+      int i1 = MIN (i + 1, width - 1);
+
+      d1[i * 2] = s1[i];
+      d1[i * 2 + 1] = (s1[i] + s1[i1] + 1) >> 1;
+      d2[i * 2] = (s1[i] + s2[i] + 1) >> 1;
+      d2[i * 2 + 1] = (s1[i] + s1[i1] + s2[i] + s2[i1] + 2) >> 2;
+    }
+  }
+}
+
+void
+ediref_upsample_guided (const guint16 * src, int width, int height,
+    const gint8 * dir_h, const gint8 * dir_v, int dir_width,
+    int dir_height, int x_shift, int y_shift, guint16 * dest)
+{
+  int dest_stride = 2 * width;
+  int i, j;
+
+  for (j = 0; j < height; j++) {
+    const guint16 *s = src + width * j;
+    const gint8 *dir = dir_h +
+        dir_width * MIN (j << y_shift, dir_height - 1);
+    guint16 *d = dest + dest_stride * 2 * j;
+
+    for (i = 0; i < width - 1; i++) {
+      d[i * 2] = s[i];
+      if (j >= MARGIN && j < height - MARGIN - 1)
+        d[i * 2 + 1] = reconstruct_v (s + i, width,
+            dir[MIN (i << x_shift, dir_width - 1)]);
+      else
+        d[i * 2 + 1] = (s[i] + s[i + 1] + 1) >> 1;
+    }
+    d[i * 2] = s[i];
+    d[i * 2 + 1] = s[i];
+  }
+  for (j = 0; j < height - 1; j++) {
+    const gint8 *dir = dir_v +
+        2 * dir_width * MIN (j << y_shift, dir_height - 1);
+    guint16 *d1 = dest + dest_stride * 2 * j;
+    guint16 *d2 = dest + dest_stride * (2 * j + 1);
+    guint16 *d3 = dest + dest_stride * (2 * j + 2);
+
+    for (i = 0; i < width * 2; i++) {
+      if (i >= MARGIN && i < width * 2 - MARGIN - 1)
+        d2[i] = reconstruct_h (d1 + i, d3 + i,
+            dir[MIN (i << x_shift, 2 * dir_width - 1)]);
+      else
+        d2[i] = (d1[i] + d3[i] + 1) >> 1;
+    }
+  }
+  {
+    guint16 *d1 = dest + dest_stride * 2 * j;
+    guint16 *d2 = dest + dest_stride * (2 * j + 1);
+
+    for (i = 0; i < width; i++) {
+      d1[2 * i + 1] = d1[i * 2];
+      d2[2 * i] = d1[i * 2];
+      d2[2 * i + 1] = d1[i * 2];
+    }
+  }
+}
+
+int
+ediref_rgb_luma (int r, int g, int b)
+{
+  return (54 * r + 183 * g + 19 * b + 128) >> 8;
+}
+
+void
+ediref_deinterlace (EdiMethod method, const guint16 * src, int width,
+    int height, int max, int field, guint16 * dest)
+{
+  int j;
+
+  for (j = 0; j < height; j++) {
+    const guint16 *s = src + width * j;
+    guint16 *d = dest + width * j;
+
+    if ((j & 1) == field || height == 1) {
+      memcpy (d, s, width * sizeof (guint16));
+    } else if (j == 0) {
+      memcpy (d, s + width, width * sizeof (guint16));
+    } else if (j == height - 1) {
+      memcpy (d, s - width, width * sizeof (guint16));
+    } else if (method == EDI_METHOD_CGAK) {
+      cgak_line (s - width, s + width, width, max, d, NULL);
+    } else {
+      int i;
+
+      for (i = 0; i < width; i++)
+        d[i] = (s[i - width] + s[i + width] + 1) >> 1;
+    }
+  }
+}
@@ -0,0 +1,67 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _EDI_REF_H_
+#define _EDI_REF_H_
+
+#include "edi.h"
+
+G_BEGIN_DECLS
+
+/* The scalar kernels the edi library started from, frozen for editest to
+ * hold it to.  They are not optimized along with it: where the two
+ * differ, one of them is wrong, and that has to be understood first.
+ *
+ * They work on a single channel at a time, with the samples of any depth
+ * held as guint16 of at most max, in planes without padding: src of
+ * width x height, dest of 2 * width x 2 * height. */
+
+/* Upsamples a luma plane, or one channel of packed RGB.  For cgak, dir_h
+ * and dir_v get the direction codes of the edi library unless they are
+ * NULL: width x height for the gaps right of the source pixels, 2 *
+ * width x height for those below the horizontally upsampled ones. */
+void ediref_upsample (EdiMethod method, const guint16 * src, int width,
+    int height, int max, guint16 * dest, gint8 * dir_h, gint8 * dir_v);
+
+/* Upsamples a chroma plane, bilinear for every method. */
+void ediref_upsample_chroma (const guint16 * src, int width, int height,
+    guint16 * dest);
+
+/* Upsamples a chroma plane, or a channel of packed RGB, along the
+ * directions ediref_upsample() found in a luma plane of dir_width x
+ * dir_height, which is x_shift and y_shift larger. */
+void ediref_upsample_guided (const guint16 * src, int width, int height,
+    const gint8 * dir_h, const gint8 * dir_v, int dir_width,
+    int dir_height, int x_shift, int y_shift, guint16 * dest);
+
+/* Deinterlaces a plane of width x height into dest of the same size: the
+ * rows of field, 0 or 1, are kept and the others interpolated between
+ * those above and below, by the second CGAK pass for cgak and by their
+ * average for bilinear, or copied from the one there is at the top and
+ * the bottom. */
+void ediref_deinterlace (EdiMethod method, const guint16 * src, int width,
+    int height, int max, int field, guint16 * dest);
+
+/* The luma estimate packed RGB finds its directions on. */
+int ediref_rgb_luma (int r, int g, int b);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,1302 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The row functions of every method, written once for a sample type.
+ * edi.c includes this once per type, with
+ *
+ *   PIXEL         the sample type
+ *   PIXEL_MAX(p)  the largest sample value of plane p
+ *   EDI_FUNC(f)   the name f gets for this type
+ *   EDI_SIMD      whether the vector kernels of edisimd.h apply
+ *
+ * Strides are in samples.  Every row function handles the p->channels
+ * interleaved channels of a pixel together: 1 for YUV, all four of packed
+ * RGB.  Chroma rows step src_pstride and dest_pstride samples from pixel
+ * to pixel; luma rows assume packed pixels. */
+
+/* Interpolates between src[0] and the pixel next samples to its right. */
+static inline int
+EDI_FUNC (reconstruct_v) (PIXEL * src, int stride, int next, int a, int b,
+    int c, int d)
+{
+  int x;
+
+  x = src[0 - 3 * stride] * a;
+  x += src[0 - 2 * stride] * b;
+  x += src[0 - 1 * stride] * c;
+  x += src[0 - 0 * stride] * d;
+  x += src[next + 0 * stride] * d;
+  x += src[next + 1 * stride] * c;
+  x += src[next + 2 * stride] * b;
+  x += src[next + 3 * stride] * a;
+  return (x + 16) >> 5;
+}
+
+/* Interpolates between d1[0] and d2[0], with next samples per pixel. */
+static inline int
+EDI_FUNC (reconstruct_h) (PIXEL * d1, PIXEL * d2, int next, int a, int b,
+    int c, int d)
+{
+  int x;
+
+  x = d1[-3 * next] * a;
+  x += d1[-2 * next] * b;
+  x += d1[-1 * next] * c;
+  x += d1[-0 * next] * d;
+  x += d2[0 * next] * d;
+  x += d2[1 * next] * c;
+  x += d2[2 * next] * b;
+  x += d2[3 * next] * a;
+  return (x + 16) >> 5;
+}
+
+static int
+EDI_FUNC (cgak_reconstruct_v) (PIXEL * s, int stride, int next, int dir)
+{
+  const int *w = cgak_weights[ABS (dir)];
+
+  return EDI_FUNC (reconstruct_v) (s, dir < 0 ? stride : -stride, next,
+      w[0], w[1], w[2], w[3]);
+}
+
+static int
+EDI_FUNC (cgak_reconstruct_h) (PIXEL * d1, PIXEL * d3, int next, int dir)
+{
+  const int *w = cgak_weights[ABS (dir)];
+
+  if (dir < 0)
+    return EDI_FUNC (reconstruct_h) (d1, d3, next, w[0], w[1], w[2], w[3]);
+  return EDI_FUNC (reconstruct_h) (d3, d1, next, w[0], w[1], w[2], w[3]);
+}
+
+/* Stores output row y, 2 * src_width pixels upsampled into line with ps
+ * samples from one to the next: as row y of the destination, as far as
+ * it goes, or with the phase layout as the odd pixels of row y / 2 of the
+ * H or the D plane, and on odd rows the even pixels into V. */
+static void
+EDI_FUNC (store_row) (const EdiPlane * p, int y, const PIXEL * line, int ps)
+{
+  int src_width = p->src_width;
+  int dps = p->dest_pstride;
+  int nc = p->channels;
+  PIXEL *d;
+  int i, c, m;
+
+  if (!p->phase_data[0]) {
+    int width = MIN (src_width * 2, p->dest_width);
+
+    if (y >= p->dest_height)
+      return;
+    d = (PIXEL *) p->dest_data + p->dest_stride * y;
+    if (ps == nc && dps == nc) {
+      memcpy (d, line, width * nc * sizeof (PIXEL));
+    } else {
+      for (i = 0; i < width; i++)
+        for (c = 0; c < nc; c++)
+          d[i * dps + c] = line[i * ps + c];
+    }
+    return;
+  }
+
+  /* an even row holds H, an odd one V in its even pixels and D */
+  for (m = y & 1; m <= 2 * (y & 1); m++) {
+    const PIXEL *l = line + (m == 1 ? 0 : ps);
+
+    d = (PIXEL *) p->phase_data[m] + p->phase_stride[m] * (y >> 1);
+    if (ps == 1 && dps == 1) {
+      /* a loop the compiler can vectorize, for planar luma */
+      for (i = 0; i < src_width; i++)
+        d[i] = l[i * 2];
+    } else {
+      for (i = 0; i < src_width; i++)
+        for (c = 0; c < nc; c++)
+          d[i * dps + c] = l[i * 2 * ps + c];
+    }
+  }
+}
+
+/* Where the pixels of output rows 2 * j and 2 * j + 1 go, by phase: the
+ * source pixel, H, V and D, the returned number of samples apart.  With
+ * the phase layout the source pixels go nowhere, rows[0] is NULL. */
+static int
+EDI_FUNC (phase_rows) (const EdiPlane * p, int j, PIXEL ** rows)
+{
+  int ps = p->dest_pstride;
+  int m;
+
+  if (!p->phase_data[0]) {
+    rows[0] = (PIXEL *) p->dest_data + p->dest_stride * 2 * j;
+    rows[1] = rows[0] + ps;
+    rows[2] = (PIXEL *) p->dest_data + p->dest_stride * (2 * j + 1);
+    rows[3] = rows[2] + ps;
+    return 2 * ps;
+  }
+
+  rows[0] = NULL;
+  for (m = 0; m < 3; m++)
+    rows[m + 1] = (PIXEL *) p->phase_data[m] + p->phase_stride[m] * j;
+  return ps;
+}
+
+typedef void (*EDI_FUNC (h_line_func)) (const EdiPlane * p,
+    PIXEL * d, int j);
+typedef void (*EDI_FUNC (v_line_func)) (const EdiPlane * p,
+    PIXEL * d2, PIXEL * d1, PIXEL * d3, int j);
+
+/* Interpolates the gaps right of pixels [i, i1) of the source row s into
+ * the line d. */
+static void
+EDI_FUNC (cgak_h_span) (const EdiPlane * p, PIXEL * d, gint8 * dir,
+    PIXEL * s, int i, int i1)
+{
+  int src_stride = p->src_stride;
+  PIXEL *up, *down;
+  int dv0, sv0, lv0;
+
+#if EDI_SIMD
+  i += edi_simd.cgak_h_row (d + 2 * i, dir ? dir + i : NULL, s + i,
+      src_stride, i1 - i);
+#endif
+  if (i == i1)
+    return;
+
+  /* The gradients of a gap are sums of terms of the columns on either
+   * side, so each column's terms are worked out once and carried over to
+   * the next gap: the difference, the sum weighted 1, 2, 1, and the
+   * second difference of the samples above, at and below the row. */
+  up = s - src_stride;
+  down = s + src_stride;
+  dv0 = down[i] - up[i];
+  sv0 = 2 * s[i] + up[i] + down[i];
+  lv0 = 2 * s[i] - up[i] - down[i];
+  for (; i < i1; i++) {
+    int outer = up[i + 1] + down[i + 1];
+    int dv1 = down[i + 1] - up[i + 1];
+    int sv1 = 2 * s[i + 1] + outer;
+    int lv1 = 2 * s[i + 1] - outer;
+    int n, v;
+
+    n = cgak_direction (2 * (dv0 + dv1), sv1 - sv0, lv0 + lv1);
+    v = EDI_FUNC (cgak_reconstruct_v) (s + i, src_stride, 1, n);
+    d[i * 2] = s[i];
+    d[i * 2 + 1] = CLAMP (v, 0, PIXEL_MAX (p));
+    if (dir)
+      dir[i] = n;
+
+    dv0 = dv1;
+    sv0 = sv1;
+    lv0 = lv1;
+  }
+}
+
+/* Horizontally upsamples source row j into the line d. */
+static void
+EDI_FUNC (cgak_h_line) (const EdiPlane * p, PIXEL * d, int j)
+{
+  int src_width = p->src_width;
+  PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+  gint8 *dir = p->dir_h ? p->dir_h + p->dir_stride * j : NULL;
+  int i, i1, k, v;
+
+  if (j >= MARGIN && j < p->src_height - MARGIN - 1) {
+    for (i = 0; i < src_width - 1; i = i1) {
+      i1 = flat_run (p, i, j, 0, src_width - 1, &v);
+      if (v < 0) {
+        EDI_FUNC (cgak_h_span) (p, d, dir, s, i, i1);
+      } else {
+        for (k = 2 * i; k < 2 * i1; k++)
+          d[k] = v;
+        if (dir)
+          memset (dir + i, 0, i1 - i);
+      }
+    }
+    d[i * 2] = s[i];
+    d[i * 2 + 1] = s[i];
+    if (dir)
+      dir[i] = 0;
+  } else {
+    for (i = 0; i < src_width - 1; i++) {
+      d[i * 2] = s[i];
+      d[i * 2 + 1] = (s[i] + s[i + 1] + 1) >> 1;
+    }
+    d[i * 2] = s[i];
+    d[i * 2 + 1] = s[i];
+    if (dir)
+      memset (dir, 0, src_width);
+  }
+
+  if (p->dir_counts && j < p->src_height - 1)
+    count_line_dirs (p, j, dir, src_width - 1, TRUE);
+}
+
+/* Interpolates pixels [i, i1) of the line d2 between d1 and d3, away from
+ * the ends of the line, clamped to max. */
+static void
+EDI_FUNC (cgak_v_span) (PIXEL * d2, gint8 * dir, PIXEL * d1, PIXEL * d3,
+    int i, int i1, int max)
+{
+  int pv0, dv0, pv1, dv1;
+
+#if EDI_SIMD
+  i += edi_simd.cgak_v_row (d2 + i, dir ? dir + i : NULL, d1 + i, d3 + i,
+      i1 - i);
+#endif
+  if (i == i1)
+    return;
+
+  /* the same with the sum and difference of d1 and d3 in each column,
+   * over the three columns around the pixel */
+  pv0 = d1[i - 1] + d3[i - 1];
+  dv0 = d3[i - 1] - d1[i - 1];
+  pv1 = d1[i] + d3[i];
+  dv1 = d3[i] - d1[i];
+  for (; i < i1; i++) {
+    int pv2 = d1[i + 1] + d3[i + 1];
+    int dv2 = d3[i + 1] - d1[i + 1];
+    int n, v;
+
+    n = cgak_direction (2 * (pv2 - pv0), dv0 + 2 * dv1 + dv2,
+        2 * pv1 - pv0 - pv2);
+    v = EDI_FUNC (cgak_reconstruct_h) (d1 + i, d3 + i, 1, n);
+    d2[i] = CLAMP (v, 0, max);
+    if (dir)
+      dir[i] = n;
+
+    pv0 = pv1;
+    dv0 = dv1;
+    pv1 = pv2;
+    dv1 = dv2;
+  }
+}
+
+/* Interpolates the line d2 between the upsampled lines d1 and d3 of
+ * source rows j and j + 1. */
+static void
+EDI_FUNC (cgak_v_line) (const EdiPlane * p, PIXEL * d2, PIXEL * d1,
+    PIXEL * d3, int j)
+{
+  int src_width = p->src_width;
+  gint8 *dir = p->dir_v ? p->dir_v + p->dir_stride * 2 * j : NULL;
+  int end = src_width * 2 - MARGIN - 1;
+  int i, i1, k, v;
+
+  for (i = 0; i < src_width * 2; i = i1) {
+    if (i < MARGIN || i >= end) {
+      d2[i] = (d1[i] + d3[i] + 1) >> 1;
+      if (dir)
+        dir[i] = 0;
+      i1 = i + 1;
+      continue;
+    }
+
+    i1 = flat_run (p, i, j, 1, end, &v);
+    if (v < 0) {
+      EDI_FUNC (cgak_v_span) (d2, dir, d1, d3, i, i1, PIXEL_MAX (p));
+    } else {
+      for (k = i; k < i1; k++)
+        d2[k] = v;
+      if (dir)
+        memset (dir + i, 0, i1 - i);
+    }
+  }
+
+  if (p->dir_counts)
+    count_line_dirs (p, j, dir, src_width * 2, FALSE);
+}
+
+/* Upsamples row j into the line d along the directions found in the
+ * luma, which is subsampled for chroma and estimated for RGB. */
+static void
+EDI_FUNC (guided_h_line) (const EdiPlane * p, PIXEL * d, int j)
+{
+  int src_width = p->src_width;
+  int ps = p->src_pstride;
+  int nc = p->channels;
+  PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+  gint8 *dir = p->dir_h +
+      p->dir_stride * MIN (j << p->y_shift, p->dir_height - 1);
+  int last = p->dir_stride - 1;
+  int i, c;
+
+  if (j >= MARGIN && j < p->src_height - MARGIN - 1) {
+    for (i = 0; i < src_width - 1; i++) {
+      int n = dir[MIN (i << p->x_shift, last)];
+
+      for (c = 0; c < nc; c++) {
+        d[i * 2 * nc + c] = s[i * ps + c];
+        d[(i * 2 + 1) * nc + c] =
+            EDI_FUNC (cgak_reconstruct_v) (s + i * ps + c, p->src_stride, ps,
+            n);
+      }
+    }
+  } else {
+    for (i = 0; i < src_width - 1; i++) {
+      for (c = 0; c < nc; c++) {
+        d[i * 2 * nc + c] = s[i * ps + c];
+        d[(i * 2 + 1) * nc + c] = (s[i * ps + c] + s[(i + 1) * ps + c] + 1)
+            >> 1;
+      }
+    }
+  }
+  for (c = 0; c < nc; c++) {
+    d[i * 2 * nc + c] = s[i * ps + c];
+    d[(i * 2 + 1) * nc + c] = s[i * ps + c];
+  }
+}
+
+static void
+EDI_FUNC (guided_v_line) (const EdiPlane * p, PIXEL * d2, PIXEL * d1,
+    PIXEL * d3, int j)
+{
+  int src_width = p->src_width;
+  int ps = p->dest_pstride;
+  int nc = p->channels;
+  gint8 *dir = p->dir_v +
+      p->dir_stride * 2 * MIN (j << p->y_shift, p->dir_height - 1);
+  int last = 2 * p->dir_stride - 1;
+  int i, c;
+
+  for (i = 0; i < src_width * 2; i++) {
+    if (i >= MARGIN && i < src_width * 2 - MARGIN - 1) {
+      int n = dir[MIN (i << p->x_shift, last)];
+
+      for (c = 0; c < nc; c++)
+        d2[i * ps + c] = EDI_FUNC (cgak_reconstruct_h) (d1 + i * nc + c,
+            d3 + i * nc + c, nc, n);
+    } else {
+      for (c = 0; c < nc; c++)
+        d2[i * ps + c] = (d1[i * nc + c] + d3[i * nc + c] + 1) >> 1;
+    }
+  }
+}
+
+/* Both passes run in one sweep over the band.  The upsampled even lines
+ * go through a ring of two line buffers, so each odd line is built while
+ * its neighbours are still in cache and the destination is only written.
+ * The line below the band is computed into the ring as well, with the
+ * plane ahead, but left for the next band to store.  The ring holds
+ * packed pixels; v_line writes d2 with the destination's pixel stride,
+ * into a third line when the destination ends short of it or is split
+ * into phases. */
+static void
+EDI_FUNC (cgak_sweep) (const EdiPlane * p, const EdiPlane * ahead, int j0,
+    int j1, EDI_FUNC (h_line_func) h_line, EDI_FUNC (v_line_func) v_line)
+{
+  int src_width = p->src_width;
+  int ps = p->dest_pstride;
+  int nc = p->channels;
+  PIXEL *lines[3];
+  gboolean direct;
+  int i, j, c;
+
+  lines[0] = (PIXEL *) p->scratch;
+  lines[1] = lines[0] + src_width * 2 * nc;
+  lines[2] = lines[1] + src_width * 2 * nc;
+  /* odd lines go straight to the destination when they fit it */
+  direct = !p->phase_data[0] && p->dest_width == 2 * src_width &&
+      p->dest_height == 2 * p->src_height;
+
+  h_line (p, lines[j0 & 1], j0);
+  for (j = j0; j < j1; j++) {
+    PIXEL *d2 = (PIXEL *) p->dest_data + p->dest_stride * (2 * j + 1);
+    PIXEL *cur = lines[j & 1];
+    PIXEL *next = lines[(j + 1) & 1];
+
+    if (!direct)
+      d2 = lines[2];
+
+    if (j < p->src_height - 1) {
+      h_line (j + 1 < j1 ? p : ahead, next, j + 1);
+      v_line (p, d2, cur, next, j);
+      EDI_FUNC (store_row) (p, 2 * j, cur, nc);
+      if (!direct)
+        EDI_FUNC (store_row) (p, 2 * j + 1, d2, ps);
+    } else {
+      /* the last row pair repeats the source pixels */
+      for (i = 0; i < src_width; i++)
+        for (c = 0; c < nc; c++)
+          cur[(i * 2 + 1) * nc + c] = cur[i * 2 * nc + c];
+      EDI_FUNC (store_row) (p, 2 * j, cur, nc);
+      EDI_FUNC (store_row) (p, 2 * j + 1, cur, nc);
+    }
+  }
+}
+
+/* Finds the blocks of block rows row0 to row0 + n_rows - 1 whose CGAK
+ * output is a single value.  A gap whose gradients only see one value is
+ * flat and gets the average of its neighbours, so that is the case when
+ * the source holds the value one pixel around the block, and two below
+ * it, where the last line is interpolated towards the next block.  Any
+ * texture gives itself away within a few samples. */
+static void
+EDI_FUNC (cgak_flat_blocks) (const EdiPlane * p, int *flat, int row0,
+    int n_rows, int n_cols)
+{
+  int b, c, i, j;
+
+  for (b = 0; b < n_rows; b++) {
+    int j0 = MAX ((row0 + b) * FLAT_BLOCK - 1, 0);
+    int j1 = MIN ((row0 + b + 1) * FLAT_BLOCK + 2, p->src_height);
+
+    for (c = 0; c < n_cols; c++) {
+      int i0 = MAX (c * FLAT_BLOCK - 1, 0);
+      int i1 = MIN ((c + 1) * FLAT_BLOCK + 1, p->src_width);
+      PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j0;
+      int v = s[i0];
+
+      for (j = j0; j < j1 && v >= 0; j++, s += p->src_stride) {
+        for (i = i0; i < i1; i++) {
+          if (s[i] != v) {
+            v = -1;
+            break;
+          }
+        }
+      }
+      flat[b * n_cols + c] = v;
+    }
+  }
+}
+
+static void
+EDI_FUNC (cgak_luma_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EdiPlane q = *p;
+  EdiPlane ahead;
+  int *flat;
+  int n_rows;
+
+  /* the sweep also upsamples row j1 when there is one */
+  q.flat_row0 = j0 / FLAT_BLOCK;
+  q.flat_stride = (p->src_width + FLAT_BLOCK - 1) / FLAT_BLOCK;
+  n_rows = MIN (j1, p->src_height - 1) / FLAT_BLOCK - q.flat_row0 + 1;
+  flat = (int *) p->scratch;
+  EDI_FUNC (cgak_flat_blocks) (p, flat, q.flat_row0, n_rows, q.flat_stride);
+  q.flat = flat;
+  q.scratch = p->scratch + SCRATCH_ROUND (n_rows * q.flat_stride *
+      sizeof (int));
+  /* counted alone, the directions of a line only go through a line */
+  if (p->dir_counts && !p->dir_h) {
+    q.dir_h = (gint8 *) q.scratch;
+    q.dir_v = q.dir_h;
+    q.dir_stride = 0;
+    q.scratch += SCRATCH_ROUND (p->src_width * 2);
+  }
+
+  /* the directions of row j1 are the next band's to write, and count */
+  ahead = q;
+  ahead.dir_h = NULL;
+  ahead.dir_counts = NULL;
+  EDI_FUNC (cgak_sweep) (&q, &ahead, j0, j1, EDI_FUNC (cgak_h_line),
+      EDI_FUNC (cgak_v_line));
+
+  /* nothing is interpolated below the last row */
+  if (p->dir_v && j1 == p->src_height)
+    memset (p->dir_v + p->dir_stride * 2 * (j1 - 1), 0, p->src_width * 2);
+}
+
+/* Edge-directed chroma at about the cost of bilinear: the directions come
+ * from the luma of the same frame instead of the chroma's own gradients. */
+static void
+EDI_FUNC (guided_chroma_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EDI_FUNC (cgak_sweep) (p, p, j0, j1, EDI_FUNC (guided_h_line),
+      EDI_FUNC (guided_v_line));
+}
+
+static inline int
+EDI_FUNC (dirac_h_edge) (PIXEL * s, int i, int src_width, int nc, int max)
+{
+  return dirac_filter (s[CLAMP (i - 3, 0, src_width - 1) * nc],
+      s[CLAMP (i - 2, 0, src_width - 1) * nc],
+      s[CLAMP (i - 1, 0, src_width - 1) * nc],
+      s[CLAMP (i, 0, src_width - 1) * nc],
+      s[CLAMP (i + 1, 0, src_width - 1) * nc],
+      s[CLAMP (i + 2, 0, src_width - 1) * nc],
+      s[CLAMP (i + 3, 0, src_width - 1) * nc],
+      s[CLAMP (i + 4, 0, src_width - 1) * nc], max);
+}
+
+/* Only the first three and last four pixels of a row have taps past the
+ * edge; everything between runs unclamped, mostly in the vector kernel. */
+static inline void
+EDI_FUNC (dirac_h_line) (const EdiPlane * p, PIXEL * d, PIXEL * s,
+    int nc)
+{
+  int src_width = p->src_width;
+  int i, c;
+
+  for (i = 0; i < MIN (src_width, 3); i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (dirac_h_edge) (s + c, i, src_width,
+          nc, PIXEL_MAX (p));
+    }
+  }
+  if (i < src_width - 4) {
+#if EDI_SIMD
+    if (nc == 1)
+      i += edi_simd.dirac_h_row (d + 6, s + 3, src_width - 7);
+#endif
+    for (; i < src_width - 4; i++) {
+      for (c = 0; c < nc; c++) {
+        PIXEL *t = s + i * nc + c;
+
+        d[i * 2 * nc + c] = t[0];
+        d[(i * 2 + 1) * nc + c] = dirac_filter (t[-3 * nc], t[-2 * nc],
+            t[-nc], t[0], t[nc], t[2 * nc], t[3 * nc], t[4 * nc],
+            PIXEL_MAX (p));
+      }
+    }
+  }
+  for (; i < src_width; i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (dirac_h_edge) (s + c, i, src_width,
+          nc, PIXEL_MAX (p));
+    }
+  }
+}
+
+static void
+EDI_FUNC (dirac_luma_h_rows) (const EdiPlane * p, int j0, int j1)
+{
+  PIXEL *line = NULL;
+  int j;
+
+  /* split into phases from a line */
+  if (p->phase_data[0])
+    line = (PIXEL *) p->scratch;
+
+  for (j = j0; j < j1; j++) {
+    PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+    PIXEL *d = (PIXEL *) p->dest_data + p->dest_stride * 2 * j;
+
+    if (line)
+      d = line;
+    /* a constant channel count for the common case */
+    if (p->channels == 1)
+      EDI_FUNC (dirac_h_line) (p, d, s, 1);
+    else
+      EDI_FUNC (dirac_h_line) (p, d, s, p->channels);
+    if (line)
+      EDI_FUNC (store_row) (p, 2 * j, line, p->channels);
+  }
+}
+
+/* Filters n samples of the eight lines of data, stride samples apart and
+ * centred between lines j and j + 1, into d.  The vertical taps are
+ * clamped once per row, into a table of the lines, so the pixel loop
+ * itself has no edge cases. */
+static void
+EDI_FUNC (dirac_v_line) (const EdiPlane * p, PIXEL * d, PIXEL * data,
+    int stride, int j, int n)
+{
+  const PIXEL *rows[8];
+  int i, k;
+
+  for (k = 0; k < 8; k++)
+    rows[k] = data + stride * CLAMP (j + k - 3, 0, p->src_height - 1);
+
+#if EDI_SIMD
+  i = edi_simd.dirac_v_row (d, rows, n);
+#else
+  i = 0;
+#endif
+  for (; i < n; i++) {
+    d[i] = dirac_filter (rows[0][i], rows[1][i], rows[2][i], rows[3][i],
+        rows[4][i], rows[5][i], rows[6][i], rows[7][i], PIXEL_MAX (p));
+  }
+}
+
+/* The odd rows filter the even ones, which with the phase layout are the
+ * source rows for V and the H rows for D. */
+static void
+EDI_FUNC (dirac_luma_v_rows) (const EdiPlane * p, int j0, int j1)
+{
+  PIXEL *dest_data = (PIXEL *) p->dest_data;
+  int dest_stride = p->dest_stride;
+  int n = p->src_width * p->channels;
+  int j;
+
+  for (j = j0; j < j1; j++) {
+    if (p->phase_data[0]) {
+      EDI_FUNC (dirac_v_line) (p,
+          (PIXEL *) p->phase_data[1] + p->phase_stride[1] * j,
+          (PIXEL *) p->src_data, p->src_stride, j, n);
+      EDI_FUNC (dirac_v_line) (p,
+          (PIXEL *) p->phase_data[2] + p->phase_stride[2] * j,
+          (PIXEL *) p->phase_data[0], p->phase_stride[0], j, n);
+    } else {
+      EDI_FUNC (dirac_v_line) (p, dest_data + dest_stride * (2 * j + 1),
+          dest_data, dest_stride * 2, j, 2 * n);
+    }
+  }
+}
+
+static inline int
+EDI_FUNC (daala_h_edge) (PIXEL * s, int i, int src_width, int nc, int max)
+{
+  return daala_filter (s[MAX (i - 2, 0) * nc], s[MAX (i - 1, 0) * nc],
+      s[i * nc], s[MIN (i + 1, src_width - 1) * nc],
+      s[MIN (i + 2, src_width - 1) * nc], s[MIN (i + 3, src_width - 1) * nc],
+      max);
+}
+
+/* Upsamples the line s into d with the six-tap filter, the taps past
+ * either end repeating the end pixel. */
+static void
+EDI_FUNC (daala_h_line) (const EdiPlane * p, PIXEL * d, PIXEL * s)
+{
+  int src_width = p->src_width;
+  int nc = p->channels;
+  int i, c;
+
+  for (i = 0; i < MIN (src_width, 2); i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (daala_h_edge) (s + c, i, src_width,
+          nc, PIXEL_MAX (p));
+    }
+  }
+  for (; i < src_width - 3; i++) {
+    for (c = 0; c < nc; c++) {
+      PIXEL *t = s + i * nc + c;
+
+      d[i * 2 * nc + c] = t[0];
+      d[(i * 2 + 1) * nc + c] = daala_filter (t[-2 * nc], t[-nc], t[0],
+          t[nc], t[2 * nc], t[3 * nc], PIXEL_MAX (p));
+    }
+  }
+  for (; i < src_width; i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (daala_h_edge) (s + c, i, src_width,
+          nc, PIXEL_MAX (p));
+    }
+  }
+}
+
+/* Interpolates channel c of the gap right of pixel i on the line l[3],
+ * along the CGAK direction of the lines l[2] to l[4], with the seven
+ * lines l taking the sinc_filter of their samples as the taps.  Columns
+ * past either end repeat the end pixel. */
+static inline int
+EDI_FUNC (sinc_h_pixel) (const EdiPlane * p, PIXEL ** l, int i, int c)
+{
+  int last = p->src_width - 1;
+  int nc = p->channels;
+  int x0 = MAX (i - 2, 0) * nc + c;
+  int x1 = MAX (i - 1, 0) * nc + c;
+  int x2 = i * nc + c;
+  int x3 = MIN (i + 1, last) * nc + c;
+  int x4 = MIN (i + 2, last) * nc + c;
+  int x5 = MIN (i + 3, last) * nc + c;
+  PIXEL *up = l[2], *s = l[3], *down = l[4];
+  const int *w;
+  int k, n, v;
+
+  n = cgak_direction (2 * (down[x2] + down[x3] - up[x2] - up[x3]),
+      2 * (s[x3] - s[x2]) + up[x3] + down[x3] - up[x2] - down[x2],
+      2 * (s[x2] + s[x3]) - up[x2] - down[x2] - up[x3] - down[x3]);
+  if (n == 0)
+    return daala_filter (s[x0], s[x1], s[x2], s[x3], s[x4], s[x5],
+        PIXEL_MAX (p));
+
+  /* as cgak_reconstruct_v: the left taps run from three lines above to
+   * the line itself when n < 0, from three below otherwise */
+  w = cgak_weights[ABS (n)];
+  v = 0;
+  for (k = 0; k < 4; k++) {
+    PIXEL *left = l[n < 0 ? k : 6 - k];
+    PIXEL *right = l[n < 0 ? 6 - k : k];
+
+    v += w[k] * (sinc_filter (left[x2], left[x1], left[x0]) +
+        sinc_filter (right[x3], right[x4], right[x5]));
+  }
+  v = (v + 256) >> 9;
+  return CLAMP (v, 0, PIXEL_MAX (p));
+}
+
+/* Interpolates sample x between the lines l[2] and l[3] along their CGAK
+ * direction, next samples from one pixel to the next, with the six lines
+ * l taking the sinc_filter of their samples as the taps, clamped to max.
+ * x must be MARGIN pixels from either end. */
+static inline int
+EDI_FUNC (sinc_v_pixel) (PIXEL ** l, int x, int next, int max)
+{
+  PIXEL *d1 = l[2], *d3 = l[3];
+  PIXEL *a0, *a1, *a2, *b0, *b1, *b2;
+  int pv0 = d1[x - next] + d3[x - next];
+  int pv1 = d1[x] + d3[x];
+  int pv2 = d1[x + next] + d3[x + next];
+  int dv0 = d3[x - next] - d1[x - next];
+  int dv1 = d3[x] - d1[x];
+  int dv2 = d3[x + next] - d1[x + next];
+  const int *w;
+  int k, n, v;
+
+  n = cgak_direction (2 * (pv2 - pv0), dv0 + 2 * dv1 + dv2,
+      2 * pv1 - pv0 - pv2);
+  if (n == 0)
+    return daala_filter (l[0][x], l[1][x], d1[x], d3[x], l[4][x], l[5][x],
+        max);
+
+  /* as cgak_reconstruct_h: the left taps come from d1 and the lines above
+   * it when n < 0, from d3 and those below otherwise */
+  if (n < 0) {
+    a0 = d1, a1 = l[1], a2 = l[0];
+    b0 = d3, b1 = l[4], b2 = l[5];
+  } else {
+    a0 = d3, a1 = l[4], a2 = l[5];
+    b0 = d1, b1 = l[1], b2 = l[0];
+  }
+  w = cgak_weights[ABS (n)];
+  v = 0;
+  for (k = 0; k < 4; k++) {
+    int xa = x + (k - 3) * next, xb = x + (3 - k) * next;
+
+    v += w[k] * (sinc_filter (a0[xa], a1[xa], a2[xa]) +
+        sinc_filter (b0[xb], b1[xb], b2[xb]));
+  }
+  v = (v + 256) >> 9;
+  return CLAMP (v, 0, max);
+}
+
+typedef void (*EDI_FUNC (ring_v_func)) (const EdiPlane * p, PIXEL * d,
+    PIXEL ** l);
+
+/* Runs both steps of edi-hv or daala in one sweep over the band.  The
+ * horizontally upsampled source rows go through a ring of RING_LINES
+ * lines, from two above an output row pair to three below it, so each is
+ * made once per band and only those few lines are live.  Rows past the
+ * top and bottom repeat the edge rows. */
+static void
+EDI_FUNC (ring_sweep) (const EdiPlane * p, int j0, int j1,
+    EDI_FUNC (h_line_func) h_line, EDI_FUNC (ring_v_func) v_line)
+{
+  int last = p->src_height - 1;
+  int n = p->src_width * 2 * p->channels;
+  PIXEL *ring, *l[6];
+  int j, k;
+
+  ring = (PIXEL *) p->scratch;
+
+  for (j = j0 - 2; j < j0 + 3; j++)
+    h_line (p, ring + n * ((j + RING_LINES) % RING_LINES),
+        CLAMP (j, 0, last));
+  for (j = j0; j < j1; j++) {
+    PIXEL *d2 = (PIXEL *) p->dest_data + p->dest_stride * (2 * j + 1);
+
+    h_line (p, ring + n * ((j + 3) % RING_LINES), MIN (j + 3, last));
+    for (k = 0; k < 6; k++)
+      l[k] = ring + n * ((j + k - 2 + RING_LINES) % RING_LINES);
+    EDI_FUNC (store_row) (p, 2 * j, l[2], p->channels);
+    /* the odd line is split into phases from the slot after the ones in
+     * use, which the next row refills anyway */
+    if (p->phase_data[0])
+      d2 = ring + n * ((j + 4) % RING_LINES);
+    v_line (p, d2, l);
+    if (p->phase_data[0])
+      EDI_FUNC (store_row) (p, 2 * j + 1, d2, p->channels);
+  }
+}
+
+static void
+EDI_FUNC (daala_h_row) (const EdiPlane * p, PIXEL * d, int j)
+{
+  EDI_FUNC (daala_h_line) (p, d,
+      (PIXEL *) p->src_data + p->src_stride * j);
+}
+
+static void
+EDI_FUNC (daala_v_line) (const EdiPlane * p, PIXEL * d, PIXEL ** l)
+{
+  int n = p->src_width * 2 * p->channels;
+  PIXEL *l0 = l[0], *l1 = l[1], *l2 = l[2], *l3 = l[3], *l4 = l[4];
+  PIXEL *l5 = l[5];
+  int i;
+
+  /* plain pointers, so that the compiler can vectorize the loop */
+  for (i = 0; i < n; i++) {
+    d[i] = daala_filter (l0[i], l1[i], l2[i], l3[i], l4[i], l5[i],
+        PIXEL_MAX (p));
+  }
+}
+
+/* Separable six-tap upsampling, as od_state_upsample8 in Daala. */
+static void
+EDI_FUNC (daala_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EDI_FUNC (ring_sweep) (p, j0, j1, EDI_FUNC (daala_h_row),
+      EDI_FUNC (daala_v_line));
+}
+
+/* Horizontally upsamples source row j into the line d along the edges,
+ * or with the six-tap filter near the top and bottom. */
+static void
+EDI_FUNC (edi_hv_h_row) (const EdiPlane * p, PIXEL * d, int j)
+{
+  int src_width = p->src_width;
+  int nc = p->channels;
+  PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+  PIXEL *l[7];
+  int i, c, k;
+
+  if (j < MARGIN || j >= p->src_height - MARGIN - 1) {
+    EDI_FUNC (daala_h_line) (p, d, s);
+    return;
+  }
+
+  for (k = 0; k < 7; k++)
+    l[k] = s + p->src_stride * (k - 3);
+  for (i = 0; i < src_width; i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (sinc_h_pixel) (p, l, i, c);
+    }
+  }
+}
+
+static void
+EDI_FUNC (edi_hv_v_line) (const EdiPlane * p, PIXEL * d, PIXEL ** l)
+{
+  int n = p->src_width * 2;
+  int nc = p->channels;
+  int max = PIXEL_MAX (p);
+  int i, c;
+
+  for (i = 0; i < n; i++) {
+    for (c = 0; c < nc; c++) {
+      int x = i * nc + c;
+
+      if (i >= MARGIN && i < n - MARGIN - 1) {
+        d[x] = EDI_FUNC (sinc_v_pixel) (l, x, nc, max);
+      } else {
+        d[x] = daala_filter (l[0][x], l[1][x], l[2][x], l[3][x], l[4][x],
+            l[5][x], max);
+      }
+    }
+  }
+}
+
+/* edi_hv() of main.js: CGAK with six-tap taps, horizontally first. */
+static void
+EDI_FUNC (edi_hv_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EDI_FUNC (ring_sweep) (p, j0, j1, EDI_FUNC (edi_hv_h_row),
+      EDI_FUNC (edi_hv_v_line));
+}
+
+/* Line y of the picture upsampled vertically alone: source row y / 2 on
+ * even lines, interpolated between the rows along the edges on odd ones,
+ * with the six-tap filter near the sides.  The odd lines go into buf.
+ * Lines past the top and bottom repeat the edge rows, as does the last
+ * odd line. */
+static PIXEL *
+EDI_FUNC (edi_vh_v_line) (const EdiPlane * p, PIXEL * buf, int y)
+{
+  int src_width = p->src_width;
+  int nc = p->channels;
+  int last = p->src_height - 1;
+  int max = PIXEL_MAX (p);
+  PIXEL *l[6];
+  int i, c, k;
+
+  if (y <= 0 || y >= 2 * last || (y & 1) == 0)
+    return (PIXEL *) p->src_data + p->src_stride * CLAMP (y / 2, 0, last);
+
+  for (k = 0; k < 6; k++)
+    l[k] = (PIXEL *) p->src_data + p->src_stride * CLAMP (y / 2 + k - 2, 0,
+        last);
+  for (i = 0; i < src_width; i++) {
+    for (c = 0; c < nc; c++) {
+      int x = i * nc + c;
+
+      if (i >= MARGIN && i < src_width - MARGIN - 1) {
+        buf[x] = EDI_FUNC (sinc_v_pixel) (l, x, nc, max);
+      } else {
+        buf[x] = daala_filter (l[0][x], l[1][x], l[2][x], l[3][x], l[4][x],
+            l[5][x], max);
+      }
+    }
+  }
+
+  return buf;
+}
+
+/* Upsamples output line y horizontally from l[3] along the edges of the
+ * seven vertically upsampled lines l around it, or with the six-tap
+ * filter near the top and bottom.  The last gap repeats its left pixel. */
+static void
+EDI_FUNC (edi_vh_h_line) (const EdiPlane * p, PIXEL * d, PIXEL ** l, int y)
+{
+  int src_width = p->src_width;
+  int nc = p->channels;
+  PIXEL *s = l[3];
+  int i, c;
+
+  if (y < MARGIN || y >= 2 * p->src_height - MARGIN - 1) {
+    EDI_FUNC (daala_h_line) (p, d, s);
+    return;
+  }
+
+  for (i = 0; i < src_width - 1; i++) {
+    for (c = 0; c < nc; c++) {
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = EDI_FUNC (sinc_h_pixel) (p, l, i, c);
+    }
+  }
+  for (c = 0; c < nc; c++) {
+    d[i * 2 * nc + c] = s[i * nc + c];
+    d[(i * 2 + 1) * nc + c] = s[i * nc + c];
+  }
+}
+
+/* edi_vh() of main.js: CGAK with six-tap taps, vertically first.  The
+ * vertically upsampled lines, from three above an output line to three
+ * below it, go through a ring of RING_LINES; the even ones are the
+ * source rows themselves. */
+static void
+EDI_FUNC (edi_vh_rows) (const EdiPlane * p, int j0, int j1)
+{
+  int n = p->src_width * p->channels;
+  PIXEL *ring, *lines[RING_LINES], *l[7], *line = NULL;
+  int y, k;
+
+  ring = (PIXEL *) p->scratch;
+  /* split into phases from a line after the ring */
+  if (p->phase_data[0])
+    line = ring + RING_LINES * n;
+
+  for (y = 2 * j0 - 3; y < 2 * j0 + 3; y++) {
+    k = (y + RING_LINES) % RING_LINES;
+    lines[k] = EDI_FUNC (edi_vh_v_line) (p, ring + n * k, y);
+  }
+  for (y = 2 * j0; y < 2 * j1; y++) {
+    k = (y + 3) % RING_LINES;
+    lines[k] = EDI_FUNC (edi_vh_v_line) (p, ring + n * k, y + 3);
+    for (k = 0; k < 7; k++)
+      l[k] = lines[(y + k - 3 + RING_LINES) % RING_LINES];
+    if (line) {
+      EDI_FUNC (edi_vh_h_line) (p, line, l, y);
+      EDI_FUNC (store_row) (p, y, line, p->channels);
+    } else {
+      EDI_FUNC (edi_vh_h_line) (p,
+          (PIXEL *) p->dest_data + p->dest_stride * y, l, y);
+    }
+  }
+}
+
+static inline void
+EDI_FUNC (bilinear_h_line) (const EdiPlane * p, PIXEL * d,
+    PIXEL * s, int nc)
+{
+  int src_width = p->src_width;
+  int i, c;
+
+  for (i = 0; i < src_width - 1; i++) {
+    for (c = 0; c < nc; c++) {
+      int v = (s[i * nc + c] + s[(i + 1) * nc + c] + 1) >> 1;
+
+      d[i * 2 * nc + c] = s[i * nc + c];
+      d[(i * 2 + 1) * nc + c] = CLAMP (v, 0, PIXEL_MAX (p));
+    }
+  }
+  for (c = 0; c < nc; c++) {
+    d[i * 2 * nc + c] = s[i * nc + c];
+    d[(i * 2 + 1) * nc + c] = s[i * nc + c];
+  }
+}
+
+static void
+EDI_FUNC (bilinear_luma_h_rows) (const EdiPlane * p, int j0, int j1)
+{
+  PIXEL *line = NULL;
+  int j;
+
+  if (p->phase_data[0])
+    line = (PIXEL *) p->scratch;
+
+  for (j = j0; j < j1; j++) {
+    PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+    PIXEL *d = (PIXEL *) p->dest_data + p->dest_stride * 2 * j;
+
+    if (line)
+      d = line;
+    if (p->channels == 1)
+      EDI_FUNC (bilinear_h_line) (p, d, s, 1);
+    else
+      EDI_FUNC (bilinear_h_line) (p, d, s, p->channels);
+    if (line)
+      EDI_FUNC (store_row) (p, 2 * j, line, p->channels);
+  }
+}
+
+/* Averages n samples of the lines d1 and d3 into d2. */
+static void
+EDI_FUNC (bilinear_v_line) (PIXEL * d2, PIXEL * d1, PIXEL * d3, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    d2[i] = (d1[i] + d3[i] + 1) >> 1;
+}
+
+/* The odd rows average the even ones, which with the phase layout are
+ * the source rows for V and the H rows for D.  The last repeats the row
+ * above. */
+static void
+EDI_FUNC (bilinear_luma_v_rows) (const EdiPlane * p, int j0, int j1)
+{
+  int dest_stride = p->dest_stride;
+  int n = p->src_width * p->channels;
+  int j;
+
+  for (j = j0; j < j1; j++) {
+    int j2 = MIN (j + 1, p->src_height - 1);
+
+    if (p->phase_data[0]) {
+      EDI_FUNC (bilinear_v_line) ((PIXEL *) p->phase_data[1] +
+          p->phase_stride[1] * j,
+          (PIXEL *) p->src_data + p->src_stride * j,
+          (PIXEL *) p->src_data + p->src_stride * j2, n);
+      EDI_FUNC (bilinear_v_line) ((PIXEL *) p->phase_data[2] +
+          p->phase_stride[2] * j,
+          (PIXEL *) p->phase_data[0] + p->phase_stride[0] * j,
+          (PIXEL *) p->phase_data[0] + p->phase_stride[0] * j2, n);
+    } else {
+      PIXEL *d = (PIXEL *) p->dest_data + dest_stride * (2 * j + 1);
+
+      EDI_FUNC (bilinear_v_line) (d, d - dest_stride,
+          d + (2 * j2 - 2 * j - 1) * dest_stride, 2 * n);
+    }
+  }
+}
+
+static void
+EDI_FUNC (bilinear_chroma_rows) (const EdiPlane * p, int j0, int j1)
+{
+  int src_width = p->src_width;
+  int sps = p->src_pstride;
+  /* Subsampled planes of an odd-sized output end short of the last
+   * interpolated column, or further into a cascade.  n of the source
+   * pixels of a row are stored, n_h of those right of them. */
+  int n = MIN (src_width, (p->dest_width + 1) / 2);
+  int n_h = MIN (src_width, p->dest_width / 2);
+  int i, j;
+
+  for (j = j0; j < j1 && 2 * j < p->dest_height; j++) {
+    PIXEL *s1 = (PIXEL *) p->src_data + p->src_stride * j;
+    /* the last row and column have no neighbours below and to the right,
+     * and repeat themselves */
+    PIXEL *s2 = j < p->src_height - 1 ? s1 + p->src_stride : s1;
+    PIXEL *d[4];
+    int step = EDI_FUNC (phase_rows) (p, j, d);
+    gboolean below = 2 * j + 1 < p->dest_height;
+
+    for (i = 0; i < n_h; i++) {
+      int i1 = MIN (i + 1, src_width - 1);
+      int a = s1[i * sps], b = s1[i1 * sps];
+      int c = s2[i * sps], e = s2[i1 * sps];
+
+      if (d[0])
+        d[0][i * step] = a;
+      d[1][i * step] = (a + b + 1) >> 1;
+      if (below) {
+        d[2][i * step] = (a + c + 1) >> 1;
+        d[3][i * step] = (a + b + c + e + 2) >> 2;
+      }
+    }
+    for (; i < n; i++) {
+      if (d[0])
+        d[0][i * step] = s1[i * sps];
+      if (below)
+        d[2][i * step] = (s1[i * sps] + s2[i * sps] + 1) >> 1;
+    }
+  }
+}
+
+typedef void (*EDI_FUNC (field_line_func)) (const EdiPlane * p,
+    PIXEL * d, PIXEL * s1, PIXEL * s3);
+
+/* Copies the source row s into the line d. */
+static void
+EDI_FUNC (copy_field_line) (const EdiPlane * p, PIXEL * d, PIXEL * s)
+{
+  int sps = p->src_pstride;
+  int dps = p->dest_pstride;
+  int nc = p->channels;
+  int i, c;
+
+  if (sps == nc && dps == nc) {
+    memcpy (d, s, p->src_width * nc * sizeof (PIXEL));
+  } else {
+    for (i = 0; i < p->src_width; i++)
+      for (c = 0; c < nc; c++)
+        d[i * dps + c] = s[i * sps + c];
+  }
+}
+
+/* Averages the source rows s1 and s3 into the line d. */
+static void
+EDI_FUNC (bilinear_field_line) (const EdiPlane * p, PIXEL * d, PIXEL * s1,
+    PIXEL * s3)
+{
+  int sps = p->src_pstride;
+  int dps = p->dest_pstride;
+  int nc = p->channels;
+  int i, c;
+
+  if (sps == nc && dps == nc) {
+    EDI_FUNC (bilinear_v_line) (d, s1, s3, p->src_width * nc);
+    return;
+  }
+  for (i = 0; i < p->src_width; i++)
+    for (c = 0; c < nc; c++)
+      d[i * dps + c] = (s1[i * sps + c] + s3[i * sps + c] + 1) >> 1;
+}
+
+/* Interpolates the line d between the source rows s1 and s3 the way the
+ * second CGAK pass does between upsampled lines. */
+static void
+EDI_FUNC (cgak_field_line) (const EdiPlane * p, PIXEL * d, PIXEL * s1,
+    PIXEL * s3)
+{
+  int end = p->src_width - MARGIN - 1;
+  int i;
+
+  if (end <= MARGIN) {
+    EDI_FUNC (bilinear_field_line) (p, d, s1, s3);
+    return;
+  }
+
+  for (i = 0; i < MARGIN; i++)
+    d[i] = (s1[i] + s3[i] + 1) >> 1;
+  EDI_FUNC (cgak_v_span) (d, NULL, s1, s3, MARGIN, end, PIXEL_MAX (p));
+  for (i = end; i < p->src_width; i++)
+    d[i] = (s1[i] + s3[i] + 1) >> 1;
+}
+
+/* Deinterlaces output rows 2 * j0 to 2 * j1 - 1: the rows of field
+ * p->field are copied and the others interpolated between the source
+ * rows above and below, or copied from the one there is at the top and
+ * the bottom. */
+static void
+EDI_FUNC (field_rows) (const EdiPlane * p, int j0, int j1,
+    EDI_FUNC (field_line_func) line)
+{
+  int height = p->src_height;
+  int y;
+
+  for (y = 2 * j0; y < MIN (2 * j1, height); y++) {
+    PIXEL *s = (PIXEL *) p->src_data + p->src_stride * y;
+    PIXEL *d = (PIXEL *) p->dest_data + p->dest_stride * y;
+
+    /* a single row is all there is of either field */
+    if ((y & 1) == p->field || height == 1)
+      EDI_FUNC (copy_field_line) (p, d, s);
+    else if (y == 0)
+      EDI_FUNC (copy_field_line) (p, d, s + p->src_stride);
+    else if (y == height - 1)
+      EDI_FUNC (copy_field_line) (p, d, s - p->src_stride);
+    else
+      line (p, d, s - p->src_stride, s + p->src_stride);
+  }
+}
+
+/* Only the luma of YUV finds directions; the channels of packed RGB are
+ * averaged. */
+static void
+EDI_FUNC (cgak_field_rows) (const EdiPlane * p, int j0, int j1)
+{
+  if (p->channels == 1 && p->src_pstride == 1 && p->dest_pstride == 1)
+    EDI_FUNC (field_rows) (p, j0, j1, EDI_FUNC (cgak_field_line));
+  else
+    EDI_FUNC (field_rows) (p, j0, j1, EDI_FUNC (bilinear_field_line));
+}
+
+static void
+EDI_FUNC (bilinear_field_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EDI_FUNC (field_rows) (p, j0, j1, EDI_FUNC (bilinear_field_line));
+}
+
+/* Estimates the luma of packed RGB, like srcLuma() in main.js. */
+static void
+EDI_FUNC (rgb_luma_rows) (const EdiPlane * p, int j0, int j1)
+{
+  int ps = p->src_pstride;
+  int i, j;
+
+  for (j = j0; j < j1; j++) {
+    PIXEL *s = (PIXEL *) p->src_data + p->src_stride * j;
+    PIXEL *l = (PIXEL *) p->luma_data + p->dir_stride * j;
+
+    for (i = 0; i < p->src_width; i++) {
+      l[i] = (54 * s[i * ps + p->rgb_offset[0]] +
+          183 * s[i * ps + p->rgb_offset[1]] +
+          19 * s[i * ps + p->rgb_offset[2]] + 128) >> 8;
+    }
+  }
+}
+
+/* Runs CGAK over the luma estimate for its directions alone.  The luma it
+ * produces is thrown away, into a single line. */
+static void
+EDI_FUNC (rgb_dirs_rows) (const EdiPlane * p, int j0, int j1)
+{
+  EdiPlane q = *p;
+
+  q.src_data = p->luma_data;
+  q.src_stride = p->dir_stride;
+  q.src_pstride = 1;
+  q.dest_data = p->scratch;
+  q.dest_stride = 0;
+  q.dest_pstride = 1;
+  q.phase_data[0] = NULL;
+  q.channels = 1;
+  q.scratch = p->scratch + SCRATCH_ROUND (p->src_width * 2 * sizeof (PIXEL));
+
+  EDI_FUNC (cgak_luma_rows) (&q, j0, j1);
+}
+
+/* indexed by GstEdiUpsampleMethod */
+static const EdiMethodRows EDI_FUNC (methods)[] = {
+  {{EDI_FUNC (cgak_luma_rows), NULL, NULL}, EDI_FUNC (bilinear_chroma_rows),
+        EDI_FUNC (guided_chroma_rows),
+      {EDI_FUNC (rgb_luma_rows), EDI_FUNC (rgb_dirs_rows),
+          EDI_FUNC (guided_chroma_rows)},
+      EDI_FUNC (cgak_field_rows), EDI_FUNC (bilinear_field_rows)},
+  {{EDI_FUNC (bilinear_luma_h_rows), EDI_FUNC (bilinear_luma_v_rows), NULL},
+        EDI_FUNC (bilinear_chroma_rows), NULL,
+      {EDI_FUNC (bilinear_luma_h_rows), EDI_FUNC (bilinear_luma_v_rows),
+          NULL},
+      EDI_FUNC (bilinear_field_rows), EDI_FUNC (bilinear_field_rows)},
+  {{EDI_FUNC (dirac_luma_h_rows), EDI_FUNC (dirac_luma_v_rows), NULL},
+        EDI_FUNC (bilinear_chroma_rows), NULL,
+      {EDI_FUNC (dirac_luma_h_rows), EDI_FUNC (dirac_luma_v_rows), NULL},
+      NULL, NULL},
+  {{EDI_FUNC (edi_hv_rows), NULL, NULL}, EDI_FUNC (bilinear_chroma_rows),
+        NULL, {EDI_FUNC (edi_hv_rows), NULL, NULL}, NULL, NULL},
+  {{EDI_FUNC (edi_vh_rows), NULL, NULL}, EDI_FUNC (bilinear_chroma_rows),
+        NULL, {EDI_FUNC (edi_vh_rows), NULL, NULL}, NULL, NULL},
+  {{EDI_FUNC (daala_rows), NULL, NULL}, EDI_FUNC (bilinear_chroma_rows),
+        NULL, {EDI_FUNC (daala_rows), NULL, NULL}, NULL, NULL},
+};
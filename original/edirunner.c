@@ -0,0 +1,111 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "edirunner.h"
+
+struct _EdiRunner
+{
+  guint n_threads;
+  GThreadPool *pool;
+
+  GMutex lock;
+  GCond cond;
+  gint n_pending;
+  EdiRunnerFunc func;
+};
+
+static void
+edi_runner_worker (gpointer data, gpointer user_data)
+{
+  EdiRunner *runner = user_data;
+
+  runner->func (data);
+
+  g_mutex_lock (&runner->lock);
+  if (--runner->n_pending == 0)
+    g_cond_signal (&runner->cond);
+  g_mutex_unlock (&runner->lock);
+}
+
+EdiRunner *
+edi_runner_new (guint n_threads)
+{
+  EdiRunner *runner;
+
+  g_return_val_if_fail (n_threads > 0, NULL);
+
+  runner = g_new0 (EdiRunner, 1);
+  runner->n_threads = n_threads;
+  g_mutex_init (&runner->lock);
+  g_cond_init (&runner->cond);
+
+  if (n_threads > 1) {
+    GError *error = NULL;
+
+    runner->pool = g_thread_pool_new (edi_runner_worker, runner,
+        n_threads - 1, TRUE, &error);
+    if (!runner->pool) {
+      /* carry on single-threaded rather than failing the stream */
+      g_clear_error (&error);
+      runner->n_threads = 1;
+    }
+  }
+
+  return runner;
+}
+
+void
+edi_runner_free (EdiRunner * runner)
+{
+  if (runner->pool)
+    g_thread_pool_free (runner->pool, FALSE, TRUE);
+  g_cond_clear (&runner->cond);
+  g_mutex_clear (&runner->lock);
+  g_free (runner);
+}
+
+guint
+edi_runner_get_n_threads (EdiRunner * runner)
+{
+  return runner->n_threads;
+}
+
+void
+edi_runner_run (EdiRunner * runner, EdiRunnerFunc func, gpointer * task_data)
+{
+  guint i;
+
+  runner->func = func;
+  runner->n_pending = runner->n_threads - 1;
+
+  for (i = 1; i < runner->n_threads; i++)
+    g_thread_pool_push (runner->pool, task_data[i], NULL);
+
+  func (task_data[0]);
+
+  g_mutex_lock (&runner->lock);
+  while (runner->n_pending > 0)
+    g_cond_wait (&runner->cond, &runner->lock);
+  g_mutex_unlock (&runner->lock);
+}
@@ -0,0 +1,42 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _EDI_RUNNER_H_
+#define _EDI_RUNNER_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EdiRunner EdiRunner;
+
+typedef void (*EdiRunnerFunc) (gpointer task_data);
+
+/* Runs one task per thread and waits for all of them.  The calling
+ * thread does task 0 itself, so a runner with one thread has no pool. */
+EdiRunner *edi_runner_new (guint n_threads);
+void edi_runner_free (EdiRunner * runner);
+guint edi_runner_get_n_threads (EdiRunner * runner);
+void edi_runner_run (EdiRunner * runner, EdiRunnerFunc func,
+    gpointer * task_data);
+
+G_END_DECLS
+
+#endif
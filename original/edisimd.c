@@ -0,0 +1,543 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "edisimd.h"
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#define HAVE_EDI_X86 1
+#include <immintrin.h>
+#endif
+
+/* The CGAK kernels all reduce to the same computation.  With a[k] the
+ * samples on one side of the gap and b[k] those on the other side, at
+ * offset k = -3..3 along the gap:
+ *
+ *   dx  = 2 * (a[1] + b[1] - a[-1] - b[-1])
+ *   dy  = (b[-1] + 2 * b[0] + b[1]) - (a[-1] + 2 * a[0] + a[1])
+ *   dx2 = (2 * a[0] - a[-1] - a[1]) + (2 * b[0] - b[-1] - b[1])
+ *
+ * After flipping dx so that dy >= 0, the edge leans one way or the other
+ * depending on the sign of dx, and every category of reconstruct_v() and
+ * reconstruct_h() is a weighted sum of the pairs q[k] = a[-k] + b[k]
+ * (dx < 0) or q[k] = a[k] + b[-k] (dx > 0):
+ *
+ *   flat or |dx| > 2 * dy   16 * q[0]
+ *   |dx| > dy               8 * (q[0] + q[1])
+ *   2 * |dx| > dy           4 * (q[0] + 2 * q[1] + q[2])
+ *   3 * |dx| > dy           q[0] + q[3] + 7 * (q[1] + q[2])
+ *   otherwise               4 * (q[1] + 2 * q[2] + q[3])
+ *
+ * so the vector code computes all five sums and blends them by mask.
+ * Everything stays below 2^15, which lets it run on 16-bit lanes.  The
+ * direction code is 0 when flat, otherwise the row of the table above,
+ * counting from 1, negated when dx < 0. */
+
+#ifdef HAVE_EDI_X86
+
+#define SSE41 __attribute__ ((target ("sse4.1")))
+#define AVX2 __attribute__ ((target ("avx2")))
+
+static inline SSE41 __m128i
+cgak_sse41 (const __m128i * a, const __m128i * b, __m128i * dir)
+{
+  const __m128i zero = _mm_setzero_si128 ();
+  __m128i dx, dy, dx2, ax, flip, neg, notflat;
+  __m128i q0, q1, q2, q3, r, m, n;
+
+  dx = _mm_slli_epi16 (_mm_sub_epi16 (_mm_add_epi16 (a[4], b[4]),
+          _mm_add_epi16 (a[2], b[2])), 1);
+  dy = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (b[2], b[4]),
+          _mm_slli_epi16 (b[3], 1)),
+      _mm_add_epi16 (_mm_add_epi16 (a[2], a[4]), _mm_slli_epi16 (a[3], 1)));
+  dx2 = _mm_sub_epi16 (_mm_slli_epi16 (_mm_add_epi16 (a[3], b[3]), 1),
+      _mm_add_epi16 (_mm_add_epi16 (a[2], a[4]), _mm_add_epi16 (b[2], b[4])));
+
+  flip = _mm_cmpgt_epi16 (zero, dy);
+  dx = _mm_sub_epi16 (_mm_xor_si128 (dx, flip), flip);
+  dy = _mm_abs_epi16 (dy);
+  ax = _mm_abs_epi16 (dx);
+  neg = _mm_cmpgt_epi16 (zero, dx);
+  notflat = _mm_cmpgt_epi16 (ax, _mm_slli_epi16 (_mm_abs_epi16 (dx2), 2));
+
+  q0 = _mm_add_epi16 (a[3], b[3]);
+  q1 = _mm_blendv_epi8 (_mm_add_epi16 (a[4], b[2]),
+      _mm_add_epi16 (a[2], b[4]), neg);
+  q2 = _mm_blendv_epi8 (_mm_add_epi16 (a[5], b[1]),
+      _mm_add_epi16 (a[1], b[5]), neg);
+  q3 = _mm_blendv_epi8 (_mm_add_epi16 (a[6], b[0]),
+      _mm_add_epi16 (a[0], b[6]), neg);
+
+  r = _mm_slli_epi16 (q0, 4);
+  n = _mm_sub_epi16 (zero, notflat);
+  m = _mm_andnot_si128 (_mm_cmpgt_epi16 (ax, _mm_slli_epi16 (dy, 1)), notflat);
+  r = _mm_blendv_epi8 (r, _mm_slli_epi16 (_mm_add_epi16 (q0, q1), 3), m);
+  n = _mm_sub_epi16 (n, m);
+  m = _mm_andnot_si128 (_mm_cmpgt_epi16 (ax, dy), notflat);
+  r = _mm_blendv_epi8 (r, _mm_slli_epi16 (_mm_add_epi16 (_mm_add_epi16 (q0,
+                  q2), _mm_slli_epi16 (q1, 1)), 2), m);
+  n = _mm_sub_epi16 (n, m);
+  m = _mm_andnot_si128 (_mm_cmpgt_epi16 (_mm_slli_epi16 (ax, 1), dy), notflat);
+  r = _mm_blendv_epi8 (r, _mm_add_epi16 (_mm_add_epi16 (q0, q3),
+          _mm_mullo_epi16 (_mm_add_epi16 (q1, q2), _mm_set1_epi16 (7))), m);
+  n = _mm_sub_epi16 (n, m);
+  m = _mm_andnot_si128 (_mm_cmpgt_epi16 (_mm_add_epi16 (ax,
+              _mm_slli_epi16 (ax, 1)), dy), notflat);
+  r = _mm_blendv_epi8 (r, _mm_slli_epi16 (_mm_add_epi16 (_mm_add_epi16 (q1,
+                  q3), _mm_slli_epi16 (q2, 1)), 2), m);
+  n = _mm_sub_epi16 (n, m);
+
+  *dir = _mm_sub_epi16 (_mm_xor_si128 (n, neg), neg);
+  return _mm_srli_epi16 (_mm_add_epi16 (r, _mm_set1_epi16 (16)), 5);
+}
+
+static inline SSE41 __m128i
+load8_sse41 (const guint8 * p)
+{
+  return _mm_cvtepu8_epi16 (_mm_loadl_epi64 ((const __m128i *) p));
+}
+
+static SSE41 int
+cgak_h_row_sse41 (guint8 * d, gint8 * dir, const guint8 * s, int stride,
+    int n)
+{
+  __m128i a[7], b[7], v, s8, dv;
+  int i, k;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (k = 0; k < 7; k++) {
+      a[k] = load8_sse41 (s + (k - 3) * stride + i);
+      b[k] = load8_sse41 (s + (k - 3) * stride + i + 1);
+    }
+    v = cgak_sse41 (a, b, &dv);
+    s8 = _mm_loadl_epi64 ((const __m128i *) (s + i));
+    v = _mm_packus_epi16 (v, v);
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i), _mm_unpacklo_epi8 (s8, v));
+    if (dir)
+      _mm_storel_epi64 ((__m128i *) (dir + i), _mm_packs_epi16 (dv, dv));
+  }
+  return i;
+}
+
+static SSE41 int
+cgak_v_row_sse41 (guint8 * d2, gint8 * dir, const guint8 * d1,
+    const guint8 * d3, int n)
+{
+  __m128i a[7], b[7], v, dv;
+  int i, k;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (k = 0; k < 7; k++) {
+      a[k] = load8_sse41 (d1 + i + k - 3);
+      b[k] = load8_sse41 (d3 + i + k - 3);
+    }
+    v = cgak_sse41 (a, b, &dv);
+    _mm_storel_epi64 ((__m128i *) (d2 + i), _mm_packus_epi16 (v, v));
+    if (dir)
+      _mm_storel_epi64 ((__m128i *) (dir + i), _mm_packs_epi16 (dv, dv));
+  }
+  return i;
+}
+
+static inline SSE41 __m128i
+dirac_sse41 (const __m128i * x)
+{
+  __m128i v;
+
+  v = _mm_mullo_epi16 (_mm_add_epi16 (x[3], x[4]), _mm_set1_epi16 (21));
+  v = _mm_sub_epi16 (v, _mm_mullo_epi16 (_mm_add_epi16 (x[2], x[5]),
+          _mm_set1_epi16 (7)));
+  v = _mm_add_epi16 (v, _mm_mullo_epi16 (_mm_add_epi16 (x[1], x[6]),
+          _mm_set1_epi16 (3)));
+  v = _mm_sub_epi16 (v, _mm_add_epi16 (x[0], x[7]));
+
+  return _mm_srai_epi16 (_mm_add_epi16 (v, _mm_set1_epi16 (16)), 5);
+}
+
+static SSE41 int
+dirac_h_row_sse41 (guint8 * d, const guint8 * s, int n)
+{
+  __m128i x[8], v, s8;
+  int i, k;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (k = 0; k < 8; k++)
+      x[k] = load8_sse41 (s + i + k - 3);
+    v = dirac_sse41 (x);
+    s8 = _mm_loadl_epi64 ((const __m128i *) (s + i));
+    v = _mm_packus_epi16 (v, v);
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i), _mm_unpacklo_epi8 (s8, v));
+  }
+  return i;
+}
+
+static SSE41 int
+dirac_v_row_sse41 (guint8 * d, const guint8 * const *rows, int n)
+{
+  __m128i x[8], v;
+  int i, k;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (k = 0; k < 8; k++)
+      x[k] = load8_sse41 (rows[k] + i);
+    v = dirac_sse41 (x);
+    _mm_storel_epi64 ((__m128i *) (d + i), _mm_packus_epi16 (v, v));
+  }
+  return i;
+}
+
+/* The sum of the 16 bytes of v, which are at most 255 * 16 together. */
+static inline SSE41 guint
+sum_bytes_sse41 (__m128i v)
+{
+  v = _mm_sad_epu8 (v, _mm_setzero_si128 ());
+  return _mm_cvtsi128_si32 (v) + _mm_extract_epi32 (v, 2);
+}
+
+/* Counts the codes first .. first + n_dirs - 1 of a line into a byte
+ * counter per lane and direction, added up before they can overflow.
+ * n_dirs is a constant after inlining so that the counters and codes,
+ * at most 6 of each, stay in registers. */
+static inline SSE41 void
+count_some_dirs_sse41 (guint * counts, const gint8 * dir, int n, int first,
+    int n_dirs)
+{
+  __m128i acc[6], code[6], v;
+  int i, d, k;
+
+#pragma GCC unroll 6
+  for (d = 0; d < n_dirs; d++)
+    code[d] = _mm_set1_epi8 (first + d);
+  for (i = 0; i + 16 <= n;) {
+#pragma GCC unroll 6
+    for (d = 0; d < n_dirs; d++)
+      acc[d] = _mm_setzero_si128 ();
+    for (k = 0; k < 255 && i + 16 <= n; k++, i += 16) {
+      v = _mm_loadu_si128 ((const __m128i *) (dir + i));
+#pragma GCC unroll 6
+      for (d = 0; d < n_dirs; d++)
+        acc[d] = _mm_sub_epi8 (acc[d], _mm_cmpeq_epi8 (v, code[d]));
+    }
+#pragma GCC unroll 6
+    for (d = 0; d < n_dirs; d++)
+      counts[first + 5 + d] += sum_bytes_sse41 (acc[d]);
+  }
+}
+
+static SSE41 int
+count_dirs_sse41 (guint * counts, const gint8 * dir, int n)
+{
+  count_some_dirs_sse41 (counts, dir, n, -5, 6);
+  count_some_dirs_sse41 (counts, dir, n, 1, 5);
+  return n & ~15;
+}
+
+static inline AVX2 __m256i
+cgak_avx2 (const __m256i * a, const __m256i * b, __m256i * dir)
+{
+  const __m256i zero = _mm256_setzero_si256 ();
+  __m256i dx, dy, dx2, ax, flip, neg, notflat;
+  __m256i q0, q1, q2, q3, r, m, n;
+
+  dx = _mm256_slli_epi16 (_mm256_sub_epi16 (_mm256_add_epi16 (a[4], b[4]),
+          _mm256_add_epi16 (a[2], b[2])), 1);
+  dy = _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (b[2], b[4]),
+          _mm256_slli_epi16 (b[3], 1)),
+      _mm256_add_epi16 (_mm256_add_epi16 (a[2], a[4]),
+          _mm256_slli_epi16 (a[3], 1)));
+  dx2 = _mm256_sub_epi16 (_mm256_slli_epi16 (_mm256_add_epi16 (a[3], b[3]),
+          1), _mm256_add_epi16 (_mm256_add_epi16 (a[2], a[4]),
+          _mm256_add_epi16 (b[2], b[4])));
+
+  flip = _mm256_cmpgt_epi16 (zero, dy);
+  dx = _mm256_sub_epi16 (_mm256_xor_si256 (dx, flip), flip);
+  dy = _mm256_abs_epi16 (dy);
+  ax = _mm256_abs_epi16 (dx);
+  neg = _mm256_cmpgt_epi16 (zero, dx);
+  notflat = _mm256_cmpgt_epi16 (ax,
+      _mm256_slli_epi16 (_mm256_abs_epi16 (dx2), 2));
+
+  q0 = _mm256_add_epi16 (a[3], b[3]);
+  q1 = _mm256_blendv_epi8 (_mm256_add_epi16 (a[4], b[2]),
+      _mm256_add_epi16 (a[2], b[4]), neg);
+  q2 = _mm256_blendv_epi8 (_mm256_add_epi16 (a[5], b[1]),
+      _mm256_add_epi16 (a[1], b[5]), neg);
+  q3 = _mm256_blendv_epi8 (_mm256_add_epi16 (a[6], b[0]),
+      _mm256_add_epi16 (a[0], b[6]), neg);
+
+  r = _mm256_slli_epi16 (q0, 4);
+  n = _mm256_sub_epi16 (zero, notflat);
+  m = _mm256_andnot_si256 (_mm256_cmpgt_epi16 (ax, _mm256_slli_epi16 (dy,
+              1)), notflat);
+  r = _mm256_blendv_epi8 (r, _mm256_slli_epi16 (_mm256_add_epi16 (q0, q1),
+          3), m);
+  n = _mm256_sub_epi16 (n, m);
+  m = _mm256_andnot_si256 (_mm256_cmpgt_epi16 (ax, dy), notflat);
+  r = _mm256_blendv_epi8 (r,
+      _mm256_slli_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (q0, q2),
+              _mm256_slli_epi16 (q1, 1)), 2), m);
+  n = _mm256_sub_epi16 (n, m);
+  m = _mm256_andnot_si256 (_mm256_cmpgt_epi16 (_mm256_slli_epi16 (ax, 1),
+          dy), notflat);
+  r = _mm256_blendv_epi8 (r, _mm256_add_epi16 (_mm256_add_epi16 (q0, q3),
+          _mm256_mullo_epi16 (_mm256_add_epi16 (q1, q2),
+              _mm256_set1_epi16 (7))), m);
+  n = _mm256_sub_epi16 (n, m);
+  m = _mm256_andnot_si256 (_mm256_cmpgt_epi16 (_mm256_add_epi16 (ax,
+              _mm256_slli_epi16 (ax, 1)), dy), notflat);
+  r = _mm256_blendv_epi8 (r,
+      _mm256_slli_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (q1, q3),
+              _mm256_slli_epi16 (q2, 1)), 2), m);
+  n = _mm256_sub_epi16 (n, m);
+
+  *dir = _mm256_sub_epi16 (_mm256_xor_si256 (n, neg), neg);
+  return _mm256_srli_epi16 (_mm256_add_epi16 (r, _mm256_set1_epi16 (16)), 5);
+}
+
+static inline AVX2 __m256i
+load16_avx2 (const guint8 * p)
+{
+  return _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *) p));
+}
+
+static inline AVX2 __m128i
+pack16_avx2 (__m256i v)
+{
+  return _mm_packus_epi16 (_mm256_castsi256_si128 (v),
+      _mm256_extracti128_si256 (v, 1));
+}
+
+static inline AVX2 __m128i
+packs16_avx2 (__m256i v)
+{
+  return _mm_packs_epi16 (_mm256_castsi256_si128 (v),
+      _mm256_extracti128_si256 (v, 1));
+}
+
+static AVX2 int
+cgak_h_row_avx2 (guint8 * d, gint8 * dir, const guint8 * s, int stride,
+    int n)
+{
+  __m256i a[7], b[7], dv;
+  __m128i v, s8;
+  int i, k;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    for (k = 0; k < 7; k++) {
+      a[k] = load16_avx2 (s + (k - 3) * stride + i);
+      b[k] = load16_avx2 (s + (k - 3) * stride + i + 1);
+    }
+    v = pack16_avx2 (cgak_avx2 (a, b, &dv));
+    s8 = _mm_loadu_si128 ((const __m128i *) (s + i));
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i), _mm_unpacklo_epi8 (s8, v));
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i + 16), _mm_unpackhi_epi8 (s8,
+            v));
+    if (dir)
+      _mm_storeu_si128 ((__m128i *) (dir + i), packs16_avx2 (dv));
+  }
+  return i + cgak_h_row_sse41 (d + 2 * i, dir ? dir + i : NULL, s + i,
+      stride, n - i);
+}
+
+static AVX2 int
+cgak_v_row_avx2 (guint8 * d2, gint8 * dir, const guint8 * d1,
+    const guint8 * d3, int n)
+{
+  __m256i a[7], b[7], dv;
+  int i, k;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    for (k = 0; k < 7; k++) {
+      a[k] = load16_avx2 (d1 + i + k - 3);
+      b[k] = load16_avx2 (d3 + i + k - 3);
+    }
+    _mm_storeu_si128 ((__m128i *) (d2 + i), pack16_avx2 (cgak_avx2 (a, b,
+                &dv)));
+    if (dir)
+      _mm_storeu_si128 ((__m128i *) (dir + i), packs16_avx2 (dv));
+  }
+  return i + cgak_v_row_sse41 (d2 + i, dir ? dir + i : NULL, d1 + i, d3 + i,
+      n - i);
+}
+
+
+static inline AVX2 __m256i
+dirac_avx2 (const __m256i * x)
+{
+  __m256i v;
+
+  v = _mm256_mullo_epi16 (_mm256_add_epi16 (x[3], x[4]),
+      _mm256_set1_epi16 (21));
+  v = _mm256_sub_epi16 (v, _mm256_mullo_epi16 (_mm256_add_epi16 (x[2], x[5]),
+          _mm256_set1_epi16 (7)));
+  v = _mm256_add_epi16 (v, _mm256_mullo_epi16 (_mm256_add_epi16 (x[1], x[6]),
+          _mm256_set1_epi16 (3)));
+  v = _mm256_sub_epi16 (v, _mm256_add_epi16 (x[0], x[7]));
+
+  return _mm256_srai_epi16 (_mm256_add_epi16 (v, _mm256_set1_epi16 (16)), 5);
+}
+
+static AVX2 int
+dirac_h_row_avx2 (guint8 * d, const guint8 * s, int n)
+{
+  __m256i x[8];
+  __m128i v, s8;
+  int i, k;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    for (k = 0; k < 8; k++)
+      x[k] = load16_avx2 (s + i + k - 3);
+    v = pack16_avx2 (dirac_avx2 (x));
+    s8 = _mm_loadu_si128 ((const __m128i *) (s + i));
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i), _mm_unpacklo_epi8 (s8, v));
+    _mm_storeu_si128 ((__m128i *) (d + 2 * i + 16), _mm_unpackhi_epi8 (s8,
+            v));
+  }
+  return i + dirac_h_row_sse41 (d + 2 * i, s + i, n - i);
+}
+
+static AVX2 int
+dirac_v_row_avx2 (guint8 * d, const guint8 * const *rows, int n)
+{
+  const guint8 *r[8];
+  __m256i x[8];
+  int i, k;
+
+  for (i = 0; i + 16 <= n; i += 16) {
+    for (k = 0; k < 8; k++)
+      x[k] = load16_avx2 (rows[k] + i);
+    _mm_storeu_si128 ((__m128i *) (d + i), pack16_avx2 (dirac_avx2 (x)));
+  }
+  for (k = 0; k < 8; k++)
+    r[k] = rows[k] + i;
+  return i + dirac_v_row_sse41 (d + i, r, n - i);
+}
+
+static inline AVX2 void
+count_some_dirs_avx2 (guint * counts, const gint8 * dir, int n, int first,
+    int n_dirs)
+{
+  __m256i acc[6], code[6], v;
+  int i, d, k;
+
+#pragma GCC unroll 6
+  for (d = 0; d < n_dirs; d++)
+    code[d] = _mm256_set1_epi8 (first + d);
+  for (i = 0; i + 32 <= n;) {
+#pragma GCC unroll 6
+    for (d = 0; d < n_dirs; d++)
+      acc[d] = _mm256_setzero_si256 ();
+    for (k = 0; k < 255 && i + 32 <= n; k++, i += 32) {
+      v = _mm256_loadu_si256 ((const __m256i *) (dir + i));
+#pragma GCC unroll 6
+      for (d = 0; d < n_dirs; d++)
+        acc[d] = _mm256_sub_epi8 (acc[d], _mm256_cmpeq_epi8 (v, code[d]));
+    }
+#pragma GCC unroll 6
+    for (d = 0; d < n_dirs; d++) {
+      counts[first + 5 + d] +=
+          sum_bytes_sse41 (_mm256_castsi256_si128 (acc[d])) +
+          sum_bytes_sse41 (_mm256_extracti128_si256 (acc[d], 1));
+    }
+  }
+}
+
+/* The same as count_dirs_sse41() on twice as many codes at a time. */
+static AVX2 int
+count_dirs_avx2 (guint * counts, const gint8 * dir, int n)
+{
+  int i = n & ~31;
+
+  count_some_dirs_avx2 (counts, dir, n, -5, 6);
+  count_some_dirs_avx2 (counts, dir, n, 1, 5);
+  return i + count_dirs_sse41 (counts, dir + i, n - i);
+}
+
+#endif
+
+static int
+cgak_h_row_c (G_GNUC_UNUSED guint8 * d, G_GNUC_UNUSED gint8 * dir,
+    G_GNUC_UNUSED const guint8 * s, G_GNUC_UNUSED int stride,
+    G_GNUC_UNUSED int n)
+{
+  return 0;
+}
+
+static int
+cgak_v_row_c (G_GNUC_UNUSED guint8 * d2, G_GNUC_UNUSED gint8 * dir,
+    G_GNUC_UNUSED const guint8 * d1, G_GNUC_UNUSED const guint8 * d3,
+    G_GNUC_UNUSED int n)
+{
+  return 0;
+}
+
+static int
+dirac_h_row_c (G_GNUC_UNUSED guint8 * d, G_GNUC_UNUSED const guint8 * s,
+    G_GNUC_UNUSED int n)
+{
+  return 0;
+}
+
+static int
+dirac_v_row_c (G_GNUC_UNUSED guint8 * d,
+    G_GNUC_UNUSED const guint8 * const *rows, G_GNUC_UNUSED int n)
+{
+  return 0;
+}
+
+static int
+count_dirs_c (G_GNUC_UNUSED guint * counts, G_GNUC_UNUSED const gint8 * dir,
+    G_GNUC_UNUSED int n)
+{
+  return 0;
+}
+
+void
+edi_simd_init (EdiSimd * simd)
+{
+  simd->name = "c";
+  simd->cgak_h_row = cgak_h_row_c;
+  simd->cgak_v_row = cgak_v_row_c;
+  simd->dirac_h_row = dirac_h_row_c;
+  simd->dirac_v_row = dirac_v_row_c;
+  simd->count_dirs = count_dirs_c;
+
+#ifdef HAVE_EDI_X86
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")) {
+    simd->name = "avx2";
+    simd->cgak_h_row = cgak_h_row_avx2;
+    simd->cgak_v_row = cgak_v_row_avx2;
+    simd->dirac_h_row = dirac_h_row_avx2;
+    simd->dirac_v_row = dirac_v_row_avx2;
+    simd->count_dirs = count_dirs_avx2;
+  } else if (__builtin_cpu_supports ("sse4.1")) {
+    simd->name = "sse4.1";
+    simd->cgak_h_row = cgak_h_row_sse41;
+    simd->cgak_v_row = cgak_v_row_sse41;
+    simd->dirac_h_row = dirac_h_row_sse41;
+    simd->dirac_v_row = dirac_v_row_sse41;
+    simd->count_dirs = count_dirs_sse41;
+  }
+#endif
+}
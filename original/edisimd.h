@@ -0,0 +1,77 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _EDI_SIMD_H_
+#define _EDI_SIMD_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Row kernels for the interior of the two CGAK luma passes.  Each one
+ * handles as many pixels as fit in whole vectors, starting at pixel 0,
+ * and returns how many it did; the caller finishes the row with the
+ * scalar code.
+ *
+ * h_row: interpolates between s[i] and s[i + 1] for i < n, writing
+ *   d[2 * i] and d[2 * i + 1].  Rows -3 to +3 around s must be valid.
+ * v_row: interpolates between d1[i] and d3[i] for i < n, writing d2[i].
+ *   Columns -3 to n + 2 of d1 and d3 must be valid.
+ *
+ * Unless dir is NULL, dir[i] receives the direction picked for pixel i:
+ * 0 where the neighbourhood is flat, otherwise 1 to 5 from the steepest
+ * edge to the shallowest, negated when the edge leans back (dx < 0). */
+typedef int (*EdiCgakHRowFunc) (guint8 * d, gint8 * dir, const guint8 * s,
+    int stride, int n);
+typedef int (*EdiCgakVRowFunc) (guint8 * d2, gint8 * dir, const guint8 * d1,
+    const guint8 * d3, int n);
+
+/* Row kernels for the Dirac 8-tap filter (-1 3 -7 21 21 -7 3 -1) / 32,
+ * for pixels whose taps need no clamping.  Same contract as above.
+ *
+ * h_row: filters s[i - 3] .. s[i + 4] for i < n, writing d[2 * i] and
+ *   d[2 * i + 1].
+ * v_row: filters rows[0][i] .. rows[7][i] for i < n, writing d[i]. */
+typedef int (*EdiDiracHRowFunc) (guint8 * d, const guint8 * s, int n);
+typedef int (*EdiDiracVRowFunc) (guint8 * d, const guint8 * const *rows,
+    int n);
+
+/* Counts the direction codes dir[i] for i < n, adding how many are d to
+ * counts[d + 5] for d = -5..5.  Same contract as above. */
+typedef int (*EdiCountDirsFunc) (guint * counts, const gint8 * dir, int n);
+
+typedef struct _EdiSimd EdiSimd;
+
+struct _EdiSimd
+{
+  const gchar *name;
+
+  EdiCgakHRowFunc cgak_h_row;
+  EdiCgakVRowFunc cgak_v_row;
+  EdiDiracHRowFunc dirac_h_row;
+  EdiDiracVRowFunc dirac_v_row;
+  EdiCountDirsFunc count_dirs;
+};
+
+void edi_simd_init (EdiSimd * simd);
+
+G_END_DECLS
+
+#endif
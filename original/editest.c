@@ -0,0 +1,727 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Holds the edi library to the frozen scalar kernels of ediref.c on
+ * random pictures.
+ *
+ *   make check
+ *
+ *   editest [iterations] [seed]
+ *
+ * make check builds it with AddressSanitizer.  Every plane is allocated
+ * to the byte, up to the last sample of its last row, so that a store
+ * past an odd-sized or exact-stride plane is caught.  Sizes go down to a
+ * single pixel, below the margins of the kernels, and the strides have a
+ * random slack.  The pictures mix noise with flat areas and edges, so
+ * that every path of the kernels is taken. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "edi.h"
+#include "ediref.h"
+
+typedef struct
+{
+  const gchar *name;
+  int n_components;
+  /* samples per pixel, more than one for packed RGB */
+  int channels;
+  int x_shift;
+  int y_shift;
+  /* the two chroma components share a plane, U first */
+  gboolean interleaved;
+  int max_depth;
+} Format;
+
+static const Format formats[] = {
+  {"GRAY", 1, 1, 0, 0, FALSE, 16},
+  {"I420", 3, 1, 1, 1, FALSE, 16},
+  {"Y42B", 3, 1, 1, 0, FALSE, 16},
+  {"Y444", 3, 1, 0, 0, FALSE, 16},
+  {"NV12", 3, 1, 1, 1, TRUE, 8},
+  {"RGBx", 1, 4, 0, 0, FALSE, 8},
+  {"RGB", 1, 3, 0, 0, FALSE, 8},
+};
+
+static const int depths[] = { 8, 10, 12, 16 };
+
+static const EdiMethod methods[] = {
+  EDI_METHOD_CGAK,
+  EDI_METHOD_BILINEAR,
+  EDI_METHOD_DIRAC,
+  EDI_METHOD_EDI_HV,
+  EDI_METHOD_EDI_VH,
+  EDI_METHOD_DAALA,
+};
+
+/* A picture and the memory of its planes. */
+typedef struct
+{
+  EdiImage img;
+  guint8 *mem[3];
+} Picture;
+
+/* One channel of one component as the reference sees it. */
+typedef struct
+{
+  guint16 *data;
+  int width;
+  int height;
+} Plane;
+
+/* Allocates the planes of a width x height picture of format like src,
+ * each on its own and with no room after its last sample, with random
+ * stride slack.  Around them is a border of padding pixels, shifted by
+ * the subsampling as edi_upsampler_run() pads. */
+static void
+picture_init (Picture * pic, const EdiImage * like, int width, int height,
+    int padding, GRand * rand)
+{
+  EdiImage *img = &pic->img;
+  int bps = like->depth > 8 ? 2 : 1;
+  int k;
+
+  *img = *like;
+  memset (pic->mem, 0, sizeof (pic->mem));
+  for (k = 0; k < img->n_components; k++) {
+    int xs = img->x_shift[k];
+    int ys = img->y_shift[k];
+    int x_pad = padding >> xs;
+    int y_pad = padding >> ys;
+    int row;
+
+    img->width[k] = (width + (1 << xs) - 1) >> xs;
+    img->height[k] = (height + (1 << ys) - 1) >> ys;
+    if (k == 2 && img->pstride[2] == 2 * bps) {
+      /* V after U in the plane of the first */
+      img->stride[2] = img->stride[1];
+      img->data[2] = img->data[1] + bps;
+      continue;
+    }
+    row = (img->width[k] + 2 * x_pad) * img->pstride[k];
+    img->stride[k] = row + bps * g_rand_int_range (rand, 0, 9);
+    pic->mem[k] = g_malloc (img->stride[k] *
+        (img->height[k] + 2 * y_pad - 1) + row);
+    img->data[k] = pic->mem[k] + img->stride[k] * y_pad +
+        img->pstride[k] * x_pad;
+  }
+}
+
+static void
+picture_clear (Picture * pic)
+{
+  int k;
+
+  for (k = 0; k < 3; k++)
+    g_free (pic->mem[k]);
+}
+
+static guint8 *
+sample_at (const EdiImage * img, int k, int c, int i, int j)
+{
+  int bps = img->depth > 8 ? 2 : 1;
+
+  return img->data[k] + img->stride[k] * j + img->pstride[k] * i + bps * c;
+}
+
+static int
+get_sample (const EdiImage * img, int k, int c, int i, int j)
+{
+  guint8 *s = sample_at (img, k, c, i, j);
+
+  return img->depth > 8 ? *(guint16 *) s : *s;
+}
+
+static void
+set_sample (const EdiImage * img, int k, int c, int i, int j, int v)
+{
+  guint8 *s = sample_at (img, k, c, i, j);
+
+  if (img->depth > 8)
+    *(guint16 *) s = v;
+  else
+    *s = v;
+}
+
+/* Fills img with one of three kinds of content: noise, flat blocks, or
+ * straight edges at random angles with a little noise. */
+static void
+picture_fill (const EdiImage * img, GRand * rand)
+{
+  int max = (1 << img->depth) - 1;
+  int kind = g_rand_int_range (rand, 0, 3);
+  int block = g_rand_int_range (rand, 4, 40);
+  int k, c, i, j;
+
+  for (k = 0; k < img->n_components; k++) {
+    for (c = 0; c < img->channels; c++) {
+      int a = g_rand_int_range (rand, -8, 9);
+      int b = g_rand_int_range (rand, -8, 9);
+      int lo = g_rand_int_range (rand, 0, max + 1);
+      int hi = g_rand_int_range (rand, 0, max + 1);
+
+      for (j = 0; j < img->height[k]; j++) {
+        for (i = 0; i < img->width[k]; i++) {
+          int v;
+
+          if (kind == 0) {
+            v = g_rand_int_range (rand, 0, max + 1);
+          } else if (kind == 1) {
+            v = ((i / block + j / block) & 1) ? hi : lo;
+          } else {
+            v = (a * i + b * j) % 17 < 8 ? hi : lo;
+            v += g_rand_int_range (rand, -2, 3);
+          }
+          set_sample (img, k, c, i, j, CLAMP (v, 0, max));
+        }
+      }
+    }
+  }
+}
+
+/* Copies the samples of src into pic, of the same size, and then changes
+ * a few random ranges of rows, or none at all. */
+static void
+picture_change (const EdiImage * img, const EdiImage * src, GRand * rand)
+{
+  int max = (1 << img->depth) - 1;
+  int n_changes = g_rand_int_range (rand, 0, 4);
+  int k, c, i, j, n;
+
+  for (k = 0; k < img->n_components; k++)
+    for (c = 0; c < img->channels; c++)
+      for (j = 0; j < img->height[k]; j++)
+        for (i = 0; i < img->width[k]; i++)
+          set_sample (img, k, c, i, j, get_sample (src, k, c, i, j));
+
+  for (n = 0; n < n_changes; n++) {
+    int j0 = g_rand_int_range (rand, 0, img->height[0]);
+    int j1 = g_rand_int_range (rand, j0, MIN (j0 + 4, img->height[0])) + 1;
+
+    /* the luma alone, a chroma component alone, or all of them */
+    k = g_rand_int_range (rand, -1, img->n_components);
+    for (j = j0; j < j1; j++) {
+      int kk;
+
+      for (kk = 0; kk < img->n_components; kk++) {
+        int jc = j >> img->y_shift[kk];
+
+        if (k >= 0 && kk != k)
+          continue;
+        i = g_rand_int_range (rand, 0, img->width[kk]);
+        c = g_rand_int_range (rand, 0, img->channels);
+        set_sample (img, kk, c, i, jc, g_rand_int_range (rand, 0, max + 1));
+      }
+    }
+  }
+}
+
+/* The number of reference planes of img, a channel of each component. */
+static int
+n_planes (const EdiImage * img)
+{
+  return img->n_components * img->channels;
+}
+
+static void
+planes_from_picture (Plane * planes, const EdiImage * img)
+{
+  int k, c, i, j;
+
+  for (k = 0; k < img->n_components; k++) {
+    for (c = 0; c < img->channels; c++) {
+      Plane *pl = &planes[k * img->channels + c];
+
+      pl->width = img->width[k];
+      pl->height = img->height[k];
+      pl->data = g_new (guint16, pl->width * pl->height);
+      for (j = 0; j < pl->height; j++)
+        for (i = 0; i < pl->width; i++)
+          pl->data[pl->width * j + i] = get_sample (img, k, c, i, j);
+    }
+  }
+}
+
+static void
+planes_clear (Plane * planes, int n)
+{
+  int m;
+
+  for (m = 0; m < n; m++)
+    g_free (planes[m].data);
+}
+
+/* Upsamples the planes of src by 2 with the reference, the way
+ * edi_upsampler_run() does a stage. */
+static void
+reference_stage (const EdiParams * params, const EdiImage * src,
+    const Plane * in, Plane * out)
+{
+  int max = (1 << src->depth) - 1;
+  gboolean guided = params->method == EDI_METHOD_CGAK &&
+      (src->channels > 1 ||
+      params->chroma_mode == EDI_CHROMA_MODE_LUMA_GUIDED);
+  int width = in[0].width;
+  int height = in[0].height;
+  gint8 *dir_h = NULL, *dir_v = NULL;
+  int m;
+
+  for (m = 0; m < n_planes (src); m++) {
+    out[m].width = 2 * in[m].width;
+    out[m].height = 2 * in[m].height;
+    out[m].data = g_new (guint16, out[m].width * out[m].height);
+  }
+  if (guided) {
+    dir_h = g_new (gint8, width * height);
+    dir_v = g_new (gint8, 2 * width * height);
+  }
+
+  if (src->channels > 1 && guided) {
+    /* all channels of packed RGB follow a luma estimate */
+    guint16 *luma = g_new (guint16, width * height);
+    guint16 *scrap = g_new (guint16, 4 * width * height);
+    const int *off = src->rgb_offset;
+    int i;
+
+    for (i = 0; i < width * height; i++)
+      luma[i] = ediref_rgb_luma (in[off[0]].data[i], in[off[1]].data[i],
+          in[off[2]].data[i]);
+    ediref_upsample (EDI_METHOD_CGAK, luma, width, height, max, scrap,
+        dir_h, dir_v);
+    for (m = 0; m < src->channels; m++)
+      ediref_upsample_guided (in[m].data, width, height, dir_h, dir_v,
+          width, height, 0, 0, out[m].data);
+    g_free (luma);
+    g_free (scrap);
+  } else if (src->channels > 1) {
+    for (m = 0; m < src->channels; m++)
+      ediref_upsample (params->method, in[m].data, width, height, max,
+          out[m].data, NULL, NULL);
+  } else {
+    ediref_upsample (params->method, in[0].data, width, height, max,
+        out[0].data, dir_h, dir_v);
+    for (m = 1; m < src->n_components; m++) {
+      if (guided)
+        ediref_upsample_guided (in[m].data, in[m].width, in[m].height,
+            dir_h, dir_v, width, height, src->x_shift[m], src->y_shift[m],
+            out[m].data);
+      else
+        ediref_upsample_chroma (in[m].data, in[m].width, in[m].height,
+            out[m].data);
+    }
+  }
+
+  g_free (dir_h);
+  g_free (dir_v);
+}
+
+/* Compares what dest holds of the planes from luma pixel x, y on, and
+ * prints the first sample that differs.  The padding around dest has to
+ * repeat its edge. */
+static gboolean
+compare_planes (const gchar * what, const EdiImage * dest,
+    const Plane * planes, int x, int y, int padding)
+{
+  int k, c, i, j;
+
+  for (k = 0; k < dest->n_components; k++) {
+    int x0 = x >> dest->x_shift[k];
+    int y0 = y >> dest->y_shift[k];
+    int x_pad = padding >> dest->x_shift[k];
+    int y_pad = padding >> dest->y_shift[k];
+
+    for (c = 0; c < dest->channels; c++) {
+      const Plane *pl = &planes[k * dest->channels + c];
+
+      g_assert (x0 + dest->width[k] <= pl->width &&
+          y0 + dest->height[k] <= pl->height);
+      for (j = -y_pad; j < dest->height[k] + y_pad; j++) {
+        for (i = -x_pad; i < dest->width[k] + x_pad; i++) {
+          int a = get_sample (dest, k, c, i, j);
+          int b = pl->data[pl->width * (y0 + CLAMP (j, 0,
+                      dest->height[k] - 1)) + x0 + CLAMP (i, 0,
+                  dest->width[k] - 1)];
+
+          if (a != b) {
+            g_print ("  %s: component %d channel %d differs at %d,%d of "
+                "%dx%d: %d != %d\n", what, k, c, i, j, dest->width[k],
+                dest->height[k], a, b);
+            return FALSE;
+          }
+        }
+      }
+    }
+  }
+  return TRUE;
+}
+
+/* Takes phase m of the 2x planes, as edi_upsampler_run_phases() stores
+ * it, into planes the size of their source. */
+static void
+planes_phase (Plane * phase, const Plane * planes, int n, int m)
+{
+  int dx = m == 1 ? 0 : 1;
+  int dy = m == 0 ? 0 : 1;
+  int i, j, k;
+
+  for (k = 0; k < n; k++) {
+    const Plane *pl = &planes[k];
+    Plane *ph = &phase[k];
+
+    ph->width = pl->width / 2;
+    ph->height = pl->height / 2;
+    ph->data = g_new (guint16, ph->width * ph->height);
+    for (j = 0; j < ph->height; j++)
+      for (i = 0; i < ph->width; i++)
+        ph->data[ph->width * j + i] =
+            pl->data[pl->width * (2 * j + dy) + 2 * i + dx];
+  }
+}
+
+/* Upsamples src by 1 << n_stages with the reference, one stage at a time
+ * into planes of the full size of each, and compares dest with the part
+ * of them it holds, that of the region of interest of params, or with
+ * phases the three phases of them. */
+static gboolean
+check_reference (const EdiParams * params, const EdiImage * src,
+    const EdiImage * dest, gboolean phases)
+{
+  static const gchar *phase_names[3] = { "phase H", "phase V", "phase D" };
+  int n = n_planes (src);
+  Plane *in = g_newa (Plane, n);
+  Plane *out = g_newa (Plane, n);
+  gboolean ret = TRUE;
+  int s, m;
+
+  planes_from_picture (in, src);
+  for (s = 0; s < params->n_stages; s++) {
+    reference_stage (params, src, in, out);
+    planes_clear (in, n);
+    memcpy (in, out, n * sizeof (Plane));
+  }
+  if (phases) {
+    for (m = 0; m < 3 && ret; m++) {
+      planes_phase (out, in, n, m);
+      ret = compare_planes (phase_names[m], &dest[m], out, 0, 0, 0);
+      planes_clear (out, n);
+    }
+  } else {
+    ret = compare_planes ("reference", dest, in,
+        params->roi_x << params->n_stages, params->roi_y << params->n_stages,
+        params->padding);
+  }
+  planes_clear (in, n);
+
+  return ret;
+}
+
+/* Deinterlaces each channel of src on its own with the reference, which
+ * finds directions in the luma of YUV alone, and compares dest with
+ * them. */
+static gboolean
+check_deinterlace (const EdiParams * params, const EdiImage * src,
+    const EdiImage * dest, int field)
+{
+  int max = (1 << src->depth) - 1;
+  int n = n_planes (src);
+  Plane *in = g_newa (Plane, n);
+  Plane *out = g_newa (Plane, n);
+  gboolean ret;
+  int m;
+
+  planes_from_picture (in, src);
+  for (m = 0; m < n; m++) {
+    EdiMethod method = m == 0 && src->channels == 1 ?
+        params->method : EDI_METHOD_BILINEAR;
+
+    out[m].width = in[m].width;
+    out[m].height = in[m].height;
+    out[m].data = g_new (guint16, out[m].width * out[m].height);
+    ediref_deinterlace (method, in[m].data, in[m].width, in[m].height, max,
+        field, out[m].data);
+  }
+  ret = compare_planes ("deinterlaced", dest, out, 0, 0, params->padding);
+  planes_clear (in, n);
+  planes_clear (out, n);
+
+  return ret;
+}
+
+/* The luma plane alone, through edi_upsample_plane() into a dest of
+ * exactly twice its size. */
+static gboolean
+check_plane (EdiMethod method, const EdiImage * src)
+{
+  EdiImage luma = *src, out;
+  Plane in, up;
+  gboolean ret;
+
+  luma.n_components = 1;
+  out = luma;
+  out.width[0] = 2 * luma.width[0];
+  out.height[0] = 2 * luma.height[0];
+  out.stride[0] = out.width[0];
+  out.data[0] = g_malloc (out.stride[0] * out.height[0]);
+  edi_upsample_plane (method, luma.data[0], luma.stride[0], luma.width[0],
+      luma.height[0], out.data[0], out.stride[0]);
+
+  planes_from_picture (&in, &luma);
+  up.width = out.width[0];
+  up.height = out.height[0];
+  up.data = g_new (guint16, up.width * up.height);
+  ediref_upsample (method, in.data, in.width, in.height, 255, up.data, NULL,
+      NULL);
+  ret = compare_planes ("plane", &out, &up, 0, 0, 0);
+
+  g_free (in.data);
+  g_free (up.data);
+  g_free (out.data[0]);
+  return ret;
+}
+
+/* Allocates what src of width x height is upsampled into: a picture
+ * of its region of interest, if any, with room for the padding, or the
+ * three phases the size of src.  img gets their layout. */
+static void
+output_init (Picture * out, EdiImage * img, const EdiParams * params,
+    gboolean phases, const EdiImage * like, int width, int height,
+    GRand * rand)
+{
+  int m;
+
+  if (params->roi_width > 0) {
+    width = params->roi_width;
+    height = params->roi_height;
+  }
+  if (!phases) {
+    picture_init (&out[0], like, width << params->n_stages,
+        height << params->n_stages, params->padding, rand);
+    img[0] = out[0].img;
+    return;
+  }
+  for (m = 0; m < 3; m++) {
+    picture_init (&out[m], like, width, height, 0, rand);
+    img[m] = out[m].img;
+  }
+}
+
+static void
+output_clear (Picture * out, gboolean phases)
+{
+  int m;
+
+  for (m = 0; m < (phases ? 3 : 1); m++)
+    picture_clear (&out[m]);
+}
+
+static gboolean
+upsample_and_check (EdiUpsampler * upsampler, const EdiParams * params,
+    const EdiImage * src, const EdiImage * dest, gboolean phases)
+{
+  if (phases)
+    edi_upsampler_run_phases (upsampler, params, src, dest);
+  else
+    edi_upsampler_run (upsampler, params, src, dest);
+
+  return check_reference (params, src, dest, phases);
+}
+
+/* A random picture of a random format, through a random setup. */
+static gboolean
+run_one (GRand * rand, EdiUpsampler * upsampler)
+{
+  const Format *format =
+      &formats[g_rand_int_range (rand, 0, G_N_ELEMENTS (formats))];
+  EdiParams params = { 0, };
+  EdiImage like = { 0, };
+  Picture src, dest[3];
+  EdiImage dest_img[3];
+  int n_threads = g_rand_int_range (rand, 1, 5);
+  int width, height, bps, k;
+  int field = -1;
+  gboolean phases;
+  gboolean ret = TRUE;
+
+  do {
+    like.depth = depths[g_rand_int_range (rand, 0, G_N_ELEMENTS (depths))];
+  } while (like.depth > format->max_depth);
+  bps = like.depth > 8 ? 2 : 1;
+  like.n_components = format->n_components;
+  like.channels = format->channels;
+  for (k = 0; k < format->n_components; k++) {
+    like.x_shift[k] = k ? format->x_shift : 0;
+    like.y_shift[k] = k ? format->y_shift : 0;
+    like.pstride[k] = bps * format->channels;
+    if (k && format->interleaved)
+      like.pstride[k] = 2 * bps;
+  }
+  if (format->channels > 1) {
+    /* RGB, BGR or with the padding first */
+    static const int orders[3][3] = { {0, 1, 2}, {2, 1, 0}, {1, 2, 3} };
+    int order = g_rand_int_range (rand, 0, format->channels == 4 ? 3 : 2);
+
+    for (k = 0; k < 3; k++)
+      like.rgb_offset[k] = orders[order][k];
+  }
+
+  params.method = methods[g_rand_int_range (rand, 0,
+          G_N_ELEMENTS (methods))];
+  params.chroma_mode = g_rand_boolean (rand) ?
+      EDI_CHROMA_MODE_LUMA_GUIDED : EDI_CHROMA_MODE_BILINEAR;
+  params.n_stages = g_rand_int_range (rand, 1, 4);
+
+  /* one in four below the margins of the kernels */
+  if (g_rand_int_range (rand, 0, 4) == 0) {
+    width = g_rand_int_range (rand, 1, 9);
+    height = g_rand_int_range (rand, 1, 9);
+  } else {
+    width = g_rand_int_range (rand, 1, 100 >> (params.n_stages - 1));
+    height = g_rand_int_range (rand, 1, 80 >> (params.n_stages - 1));
+  }
+
+  /* one in six deinterlaced instead, by a method that can, into a
+   * picture of the same size */
+  if (g_rand_int_range (rand, 0, 6) == 0) {
+    field = g_rand_int_range (rand, 0, 2);
+    params.method = g_rand_boolean (rand) ?
+        EDI_METHOD_CGAK : EDI_METHOD_BILINEAR;
+    params.n_stages = 0;
+  }
+
+  /* a third of the single steps into phases, half of the rest with a
+   * border */
+  phases = params.n_stages == 1 && g_rand_int_range (rand, 0, 3) == 0;
+  if (!phases && g_rand_boolean (rand))
+    params.padding = g_rand_int_range (rand, 1, 20);
+  /* and a third of those a region of interest anywhere */
+  if (!phases && field < 0 && g_rand_int_range (rand, 0, 3) == 0) {
+    params.roi_width = g_rand_int_range (rand, 1, width + 1);
+    params.roi_height = g_rand_int_range (rand, 1, height + 1);
+    params.roi_x = g_rand_int_range (rand, 0, width - params.roi_width + 1);
+    params.roi_y = g_rand_int_range (rand, 0,
+        height - params.roi_height + 1);
+  }
+
+  picture_init (&src, &like, width, height, 0, rand);
+  picture_fill (&src.img, rand);
+  output_init (dest, dest_img, &params, phases, &like, width, height, rand);
+
+  edi_upsampler_set_n_threads (upsampler, n_threads);
+  if (field >= 0) {
+    edi_upsampler_deinterlace (upsampler, &params, &src.img, field,
+        dest_img);
+    if (!check_deinterlace (&params, &src.img, dest_img, field))
+      ret = FALSE;
+  } else if (!upsample_and_check (upsampler, &params, &src.img, dest_img,
+          phases)) {
+    ret = FALSE;
+  }
+  if (like.depth == 8 && format->channels == 1 &&
+      !check_plane (params.method, &src.img))
+    ret = FALSE;
+
+  /* a next picture with a few rows changed, incrementally, perhaps on a
+   * different number of threads */
+  if (field < 0 && g_rand_boolean (rand)) {
+    Picture next, next_dest[3], saved;
+    EdiImage next_img[3];
+    gboolean saving;
+
+    picture_init (&next, &like, width, height, 0, rand);
+    picture_change (&next.img, &src.img, rand);
+    output_init (next_dest, next_img, &params, phases, &like, width, height,
+        rand);
+
+    /* half the time from a saved copy, which the first picture goes
+     * through again to fill, as ediupsample does */
+    saving = !phases && params.roi_width == 0 && g_rand_boolean (rand);
+    if (saving) {
+      picture_init (&saved, &like, width << params.n_stages,
+          height << params.n_stages, 0, rand);
+      params.save_dest = &saved.img;
+      edi_upsampler_run (upsampler, &params, &src.img, dest_img);
+    }
+
+    params.prev_src = &src.img;
+    params.prev_dest = saving ? &saved.img : dest_img;
+    edi_upsampler_set_n_threads (upsampler, g_rand_int_range (rand, 1, 5));
+    if (!upsample_and_check (upsampler, &params, &next.img, next_img,
+            phases)) {
+      g_print ("  after a change\n");
+      ret = FALSE;
+    }
+
+    /* which leaves the copy up to date */
+    if (saving) {
+      int n = n_planes (next_img);
+      Plane *planes = g_newa (Plane, n);
+
+      planes_from_picture (planes, next_img);
+      if (!compare_planes ("saved", &saved.img, planes, 0, 0, 0))
+        ret = FALSE;
+      planes_clear (planes, n);
+      picture_clear (&saved);
+      params.save_dest = NULL;
+    }
+
+    picture_clear (&next);
+    output_clear (next_dest, phases);
+  }
+
+  if (!ret)
+    g_print ("%s %dx%d, depth %d, method %d, chroma %d, %d stages%s, "
+        "padding %d, region %dx%d at %d,%d, %d threads, field %d\n",
+        format->name, width, height, like.depth, params.method,
+        params.chroma_mode, params.n_stages, phases ? " into phases" : "",
+        params.padding, params.roi_width, params.roi_height, params.roi_x,
+        params.roi_y, n_threads, field);
+
+  picture_clear (&src);
+  output_clear (dest, phases);
+  return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int n_iterations = argc > 1 ? atoi (argv[1]) : 1000;
+  guint32 seed = argc > 2 ? strtoul (argv[2], NULL, 0) : g_random_int ();
+  EdiUpsampler *upsampler = edi_upsampler_new (1);
+  GRand *rand = g_rand_new_with_seed (seed);
+  int n_failed = 0;
+  int i;
+
+  g_print ("editest: %d iterations, seed %u, %s\n", n_iterations, seed,
+      edi_get_simd_name ());
+  for (i = 0; i < n_iterations; i++) {
+    if (!run_one (rand, upsampler))
+      n_failed++;
+  }
+  g_print ("%d of %d failed\n", n_failed, n_iterations);
+
+  g_rand_free (rand);
+  edi_upsampler_free (upsampler);
+  return n_failed ? 1 : 0;
+}
@@ -0,0 +1,487 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Upscales a Y4M or raw I420 file to Y4M, without a pipeline.
+ *
+ *   make ediupscale
+ *
+ *   ediupscale [-m cgak] [-f 2] [-j 0] in.y4m -o out.y4m
+ *   ediupscale --raw 1920x1080 in.yuv > out.y4m
+ *
+ * The input is memory-mapped.  Frames go to a pool of workers, each with
+ * an upsampler of its own, and come back in order to be written.  At
+ * most --queue frames are in flight: the reader waits for the oldest one
+ * to be written before taking another, and hands the pages of written
+ * frames back to the kernel, so memory stays the same for any length of
+ * input. */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glib.h>
+#include "edi.h"
+
+typedef struct
+{
+  const gchar *tag;
+  int n_components;
+  int x_shift;
+  int y_shift;
+  int depth;
+} ChromaFormat;
+
+/* the Y4M chroma tags; the first is the default */
+static const ChromaFormat chroma_formats[] = {
+  {"420jpeg", 3, 1, 1, 8},
+  {"420paldv", 3, 1, 1, 8},
+  {"420mpeg2", 3, 1, 1, 8},
+  {"420", 3, 1, 1, 8},
+  {"422", 3, 1, 0, 8},
+  {"444", 3, 0, 0, 8},
+  {"mono", 1, 0, 0, 8},
+  {"420p10", 3, 1, 1, 10},
+  {"422p10", 3, 1, 0, 10},
+  {"444p10", 3, 0, 0, 10},
+  {"420p12", 3, 1, 1, 12},
+  {"422p12", 3, 1, 0, 12},
+  {"444p12", 3, 0, 0, 12},
+  {"420p16", 3, 1, 1, 16},
+  {"444p16", 3, 0, 0, 16},
+};
+
+typedef struct
+{
+  int width;
+  int height;
+  const ChromaFormat *format;
+  /* every other parameter of the stream header, each with its space */
+  GString *params;
+} Y4mHeader;
+
+typedef struct
+{
+  EdiImage in;
+  EdiImage out;
+  guint8 *out_data;
+  gboolean done;
+} Job;
+
+typedef struct
+{
+  EdiParams params;
+  /* one upsampler per worker, lent out for a frame at a time */
+  GAsyncQueue *upsamplers;
+  GMutex lock;
+  GCond cond;
+} Context;
+
+static gchar *method_name = (gchar *) "cgak";
+static gchar *chroma_mode_name = (gchar *) "bilinear";
+static gint factor = 2;
+static gint n_workers = 0;
+static gint queue_length = 0;
+static gchar *raw_size = NULL;
+static gchar *output_name = (gchar *) "-";
+
+static GOptionEntry entries[] = {
+  {"method", 'm', 0, G_OPTION_ARG_STRING, &method_name,
+      "Upsampling method: cgak, bilinear, dirac, edi-hv, edi-vh or daala",
+      "NAME"},
+  {"chroma-mode", 'c', 0, G_OPTION_ARG_STRING, &chroma_mode_name,
+      "Chroma interpolation: bilinear or luma-guided", "NAME"},
+  {"factor", 'f', 0, G_OPTION_ARG_INT, &factor,
+      "Upsampling factor: 2, 4 or 8", "N"},
+  {"jobs", 'j', 0, G_OPTION_ARG_INT, &n_workers,
+      "Frames upsampled at once (0 = number of processors)", "N"},
+  {"queue", 'q', 0, G_OPTION_ARG_INT, &queue_length,
+      "Frames in flight at most (0 = twice the jobs)", "N"},
+  {"raw", 'r', 0, G_OPTION_ARG_STRING, &raw_size,
+      "Read raw 8 bit I420 of this size instead of Y4M", "WxH"},
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_name,
+      "Output file, - for standard output", "FILE"},
+  {NULL}
+};
+
+/* Parses the stream header line of a Y4M file, without its newline. */
+static gboolean
+parse_header (Y4mHeader * header, const gchar * line, gsize len)
+{
+  gchar *copy = g_strndup (line, len);
+  gchar **tokens = g_strsplit (copy, " ", -1);
+  gboolean ret = FALSE;
+  guint t, k;
+
+  header->width = header->height = 0;
+  header->format = &chroma_formats[0];
+  header->params = g_string_new (NULL);
+
+  if (g_strcmp0 (tokens[0], "YUV4MPEG2") != 0) {
+    g_printerr ("not a Y4M file\n");
+    goto done;
+  }
+
+  for (t = 1; tokens[t]; t++) {
+    const gchar *token = tokens[t];
+
+    switch (token[0]) {
+      case 'W':
+        header->width = atoi (token + 1);
+        break;
+      case 'H':
+        header->height = atoi (token + 1);
+        break;
+      case 'C':
+        for (k = 0; k < G_N_ELEMENTS (chroma_formats); k++) {
+          if (strcmp (token + 1, chroma_formats[k].tag) == 0)
+            break;
+        }
+        if (k == G_N_ELEMENTS (chroma_formats)) {
+          g_printerr ("unsupported chroma format %s\n", token + 1);
+          goto done;
+        }
+        header->format = &chroma_formats[k];
+        break;
+      case '\0':
+        break;
+      default:
+        g_string_append_printf (header->params, " %s", token);
+        break;
+    }
+  }
+
+  if (header->width <= 0 || header->height <= 0) {
+    g_printerr ("missing or invalid frame size\n");
+    goto done;
+  }
+  ret = TRUE;
+
+done:
+  g_strfreev (tokens);
+  g_free (copy);
+  return ret;
+}
+
+/* Lays out a tightly packed frame of the header's format at data, and
+ * returns its size in bytes. */
+static gsize
+image_init (EdiImage * img, const Y4mHeader * header, int width, int height,
+    guint8 * data)
+{
+  const ChromaFormat *format = header->format;
+  int bps = format->depth > 8 ? 2 : 1;
+  gsize offset = 0;
+  int k;
+
+  memset (img, 0, sizeof (*img));
+  img->n_components = format->n_components;
+  img->channels = 1;
+  img->depth = format->depth;
+  for (k = 0; k < format->n_components; k++) {
+    img->x_shift[k] = k > 0 ? format->x_shift : 0;
+    img->y_shift[k] = k > 0 ? format->y_shift : 0;
+    img->width[k] = (width + (1 << img->x_shift[k]) - 1) >> img->x_shift[k];
+    img->height[k] =
+        (height + (1 << img->y_shift[k]) - 1) >> img->y_shift[k];
+    img->pstride[k] = bps;
+    img->stride[k] = img->width[k] * bps;
+    img->data[k] = data ? data + offset : NULL;
+    offset += (gsize) img->stride[k] * img->height[k];
+  }
+
+  return offset;
+}
+
+static void
+run_job (gpointer data, gpointer user_data)
+{
+  Job *job = data;
+  Context *ctx = user_data;
+  EdiUpsampler *upsampler = g_async_queue_pop (ctx->upsamplers);
+
+  edi_upsampler_run (upsampler, &ctx->params, &job->in, &job->out);
+  g_async_queue_push (ctx->upsamplers, upsampler);
+
+  g_mutex_lock (&ctx->lock);
+  job->done = TRUE;
+  g_cond_broadcast (&ctx->cond);
+  g_mutex_unlock (&ctx->lock);
+}
+
+/* Finds the next frame at *pos, moving *pos past it.  Returns NULL at the
+ * end of the input. */
+static const guint8 *
+next_frame (const guint8 * data, gsize size, gsize * pos, gsize frame_size,
+    gboolean raw)
+{
+  const guint8 *frame;
+
+  if (!raw) {
+    const guint8 *nl;
+
+    if (*pos == size)
+      return NULL;
+    if (size - *pos < 5 || memcmp (data + *pos, "FRAME", 5) != 0) {
+      g_printerr ("missing frame header at byte %" G_GSIZE_FORMAT "\n", *pos);
+      return NULL;
+    }
+    nl = memchr (data + *pos, '\n', size - *pos);
+    if (!nl) {
+      g_printerr ("truncated frame header\n");
+      return NULL;
+    }
+    *pos = nl + 1 - data;
+  }
+
+  if (size - *pos < frame_size) {
+    if (*pos < size)
+      g_printerr ("dropping a truncated frame at the end\n");
+    return NULL;
+  }
+
+  frame = data + *pos;
+  *pos += frame_size;
+  return frame;
+}
+
+/* Gives the pages wholly before end back to the kernel; they will not be
+ * read again. */
+static void
+release_input (const guint8 * data, gsize * released, gsize end)
+{
+  gsize page = sysconf (_SC_PAGESIZE);
+
+  end = end / page * page;
+  if (end > *released) {
+    madvise ((guint8 *) data + *released, end - *released, MADV_DONTNEED);
+    *released = end;
+  }
+}
+
+static gboolean
+write_frame (FILE * out, const Job * job, gsize size)
+{
+  return fputs ("FRAME\n", out) >= 0 &&
+      fwrite (job->out_data, 1, size, out) == size;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *option_ctx;
+  GError *error = NULL;
+  Context ctx;
+  GThreadPool *pool;
+  Y4mHeader header;
+  EdiImage layout;
+  Job *jobs;
+  FILE *out;
+  struct stat st;
+  const guint8 *data;
+  gsize size, pos = 0, released = 0, in_size, out_size;
+  gsize *frame_end;
+  guint64 n_submitted = 0, n_written = 0;
+  gboolean raw, eos = FALSE, ok = TRUE;
+  int fd, i;
+
+  option_ctx = g_option_context_new ("INPUT - upscale Y4M or raw I420 video");
+  g_option_context_add_main_entries (option_ctx, entries, NULL);
+  if (!g_option_context_parse (option_ctx, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (option_ctx);
+  if (argc != 2) {
+    g_printerr ("expected one input file\n");
+    return 1;
+  }
+
+  memset (&ctx.params, 0, sizeof (ctx.params));
+  if (strcmp (method_name, "cgak") == 0) {
+    ctx.params.method = EDI_METHOD_CGAK;
+  } else if (strcmp (method_name, "bilinear") == 0) {
+    ctx.params.method = EDI_METHOD_BILINEAR;
+  } else if (strcmp (method_name, "dirac") == 0) {
+    ctx.params.method = EDI_METHOD_DIRAC;
+  } else if (strcmp (method_name, "edi-hv") == 0) {
+    ctx.params.method = EDI_METHOD_EDI_HV;
+  } else if (strcmp (method_name, "edi-vh") == 0) {
+    ctx.params.method = EDI_METHOD_EDI_VH;
+  } else if (strcmp (method_name, "daala") == 0) {
+    ctx.params.method = EDI_METHOD_DAALA;
+  } else {
+    g_printerr ("unknown method %s\n", method_name);
+    return 1;
+  }
+  if (strcmp (chroma_mode_name, "bilinear") == 0) {
+    ctx.params.chroma_mode = EDI_CHROMA_MODE_BILINEAR;
+  } else if (strcmp (chroma_mode_name, "luma-guided") == 0) {
+    ctx.params.chroma_mode = EDI_CHROMA_MODE_LUMA_GUIDED;
+  } else {
+    g_printerr ("unknown chroma mode %s\n", chroma_mode_name);
+    return 1;
+  }
+  if (factor != 2 && factor != 4 && factor != 8) {
+    g_printerr ("factor must be 2, 4 or 8\n");
+    return 1;
+  }
+  ctx.params.n_stages = g_bit_nth_msf (factor, -1);
+  if (n_workers <= 0)
+    n_workers = g_get_num_processors ();
+  if (queue_length <= 0)
+    queue_length = 2 * n_workers;
+
+  fd = open (argv[1], O_RDONLY);
+  if (fd < 0 || fstat (fd, &st) < 0) {
+    g_printerr ("cannot open %s: %s\n", argv[1], g_strerror (errno));
+    return 1;
+  }
+  size = st.st_size;
+  if (size == 0) {
+    g_printerr ("%s is empty\n", argv[1]);
+    return 1;
+  }
+  data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED) {
+    g_printerr ("cannot map %s: %s\n", argv[1], g_strerror (errno));
+    return 1;
+  }
+  madvise ((guint8 *) data, size, MADV_SEQUENTIAL);
+
+  raw = raw_size != NULL;
+  if (raw) {
+    header.format = &chroma_formats[0];
+    header.params = g_string_new (" F25:1 Ip A1:1");
+    if (sscanf (raw_size, "%dx%d", &header.width, &header.height) != 2 ||
+        header.width <= 0 || header.height <= 0) {
+      g_printerr ("invalid raw size %s\n", raw_size);
+      return 1;
+    }
+  } else {
+    const guint8 *nl = memchr (data, '\n', MIN (size, 4096));
+
+    if (!nl || !parse_header (&header, (const gchar *) data, nl - data))
+      return 1;
+    pos = nl + 1 - data;
+  }
+
+  /* a subsampled plane doubles to the size of the full one */
+  if (header.width % (1 << header.format->x_shift) ||
+      header.height % (1 << header.format->y_shift)) {
+    g_printerr ("frame size %dx%d does not fit chroma format %s\n",
+        header.width, header.height, header.format->tag);
+    return 1;
+  }
+
+  if (strcmp (output_name, "-") == 0) {
+    out = stdout;
+  } else if (!(out = fopen (output_name, "wb"))) {
+    g_printerr ("cannot open %s: %s\n", output_name, g_strerror (errno));
+    return 1;
+  }
+  fprintf (out, "YUV4MPEG2 W%d H%d C%s%s\n", header.width * factor,
+      header.height * factor, header.format->tag, header.params->str);
+
+  in_size = image_init (&layout, &header, header.width, header.height, NULL);
+  out_size = image_init (&layout, &header, header.width * factor,
+      header.height * factor, NULL);
+
+  /* the only allocations that scale with the picture */
+  jobs = g_new0 (Job, queue_length);
+  frame_end = g_new0 (gsize, queue_length);
+  for (i = 0; i < queue_length; i++) {
+    jobs[i].out_data = g_malloc (out_size);
+    image_init (&jobs[i].out, &header, header.width * factor,
+        header.height * factor, jobs[i].out_data);
+  }
+
+  ctx.upsamplers = g_async_queue_new_full ((GDestroyNotify)
+      edi_upsampler_free);
+  for (i = 0; i < n_workers; i++)
+    g_async_queue_push (ctx.upsamplers, edi_upsampler_new (1));
+  g_mutex_init (&ctx.lock);
+  g_cond_init (&ctx.cond);
+  pool = g_thread_pool_new (run_job, &ctx, n_workers, TRUE, &error);
+  if (!pool) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+
+  while (ok && (!eos || n_written < n_submitted)) {
+    Job *job;
+
+    /* keep the queue full */
+    while (!eos && n_submitted - n_written < (guint64) queue_length) {
+      const guint8 *frame = next_frame (data, size, &pos, in_size, raw);
+
+      if (!frame) {
+        eos = TRUE;
+        break;
+      }
+      job = &jobs[n_submitted % queue_length];
+      image_init (&job->in, &header, header.width, header.height,
+          (guint8 *) frame);
+      job->done = FALSE;
+      frame_end[n_submitted % queue_length] = pos;
+      g_thread_pool_push (pool, job, NULL);
+      n_submitted++;
+    }
+    if (n_written == n_submitted)
+      break;
+
+    /* then write the oldest frame as soon as it is done */
+    job = &jobs[n_written % queue_length];
+    g_mutex_lock (&ctx.lock);
+    while (!job->done)
+      g_cond_wait (&ctx.cond, &ctx.lock);
+    g_mutex_unlock (&ctx.lock);
+
+    if (!write_frame (out, job, out_size)) {
+      g_printerr ("cannot write %s: %s\n", output_name, g_strerror (errno));
+      ok = FALSE;
+    }
+    release_input (data, &released, frame_end[n_written % queue_length]);
+    n_written++;
+  }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  if (fflush (out) != 0 || (out != stdout && fclose (out) != 0)) {
+    g_printerr ("cannot write %s: %s\n", output_name, g_strerror (errno));
+    ok = FALSE;
+  }
+  g_printerr ("%" G_GUINT64_FORMAT " frames\n", n_written);
+
+  g_async_queue_unref (ctx.upsamplers);
+  g_mutex_clear (&ctx.lock);
+  g_cond_clear (&ctx.cond);
+  for (i = 0; i < queue_length; i++)
+    g_free (jobs[i].out_data);
+  g_free (jobs);
+  g_free (frame_end);
+  g_string_free (header.params, TRUE);
+  munmap ((guint8 *) data, size);
+
+  return ok ? 0 : 1;
+}
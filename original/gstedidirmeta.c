@@ -0,0 +1,147 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/video/video.h>
+#include "gstedidirmeta.h"
+
+GType
+gst_edi_dir_meta_api_get_type (void)
+{
+  static gsize type = 0;
+  static const gchar *tags[] = { GST_META_TAG_VIDEO_STR,
+    GST_META_TAG_VIDEO_SIZE_STR, NULL
+  };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstEdiDirMetaAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return (GType) type;
+}
+
+static gboolean
+gst_edi_dir_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstEdiDirMeta *dmeta = (GstEdiDirMeta *) meta;
+
+  dmeta->width = 0;
+  dmeta->height = 0;
+  dmeta->stride = 0;
+  dmeta->data = NULL;
+  dmeta->map = NULL;
+
+  return TRUE;
+}
+
+static void
+gst_edi_dir_meta_free (GstMeta * meta, GstBuffer * buffer)
+{
+  GstEdiDirMeta *dmeta = (GstEdiDirMeta *) meta;
+
+  /* a pooled map goes back to its pool for the next frame */
+  if (dmeta->map) {
+    gst_buffer_unmap (dmeta->map, &dmeta->map_info);
+    gst_buffer_unref (dmeta->map);
+  }
+}
+
+static GstEdiDirMeta *
+add_edi_dir_meta (GstBuffer * buffer, guint width, guint height,
+    GstBuffer * map, GstMapFlags flags)
+{
+  GstEdiDirMeta *meta;
+
+  meta = (GstEdiDirMeta *) gst_buffer_add_meta (buffer,
+      GST_EDI_DIR_META_INFO, NULL);
+  if (!meta) {
+    gst_buffer_unref (map);
+    return NULL;
+  }
+  if (!gst_buffer_map (map, &meta->map_info, flags)) {
+    gst_buffer_unref (map);
+    gst_buffer_remove_meta (buffer, (GstMeta *) meta);
+    return NULL;
+  }
+
+  meta->width = width;
+  meta->height = height;
+  meta->stride = (width + 1) / 2;
+  meta->data = meta->map_info.data;
+  meta->map = map;
+
+  return meta;
+}
+
+static gboolean
+gst_edi_dir_meta_transform (GstBuffer * dest, GstMeta * meta,
+    GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstEdiDirMeta *smeta = (GstEdiDirMeta *) meta;
+  GstEdiDirMeta *dmeta;
+
+  /* the map only makes sense for the whole, unmodified picture */
+  if (GST_META_TRANSFORM_IS_COPY (type)) {
+    GstMetaTransformCopy *copy = data;
+
+    if (copy->region)
+      return FALSE;
+
+    /* the map is not written once the buffer is out, so share it */
+    dmeta = add_edi_dir_meta (dest, smeta->width, smeta->height,
+        gst_buffer_ref (smeta->map), GST_MAP_READ);
+    return dmeta != NULL;
+  }
+
+  return FALSE;
+}
+
+const GstMetaInfo *
+gst_edi_dir_meta_get_info (void)
+{
+  static const GstMetaInfo *meta_info = NULL;
+
+  if (g_once_init_enter (&meta_info)) {
+    const GstMetaInfo *mi = gst_meta_register (GST_EDI_DIR_META_API_TYPE,
+        "GstEdiDirMeta", sizeof (GstEdiDirMeta), gst_edi_dir_meta_init,
+        gst_edi_dir_meta_free, gst_edi_dir_meta_transform);
+    g_once_init_leave (&meta_info, mi);
+  }
+  return meta_info;
+}
+
+/* Adds a map of width x height codes to buffer, for the caller to fill.
+ * The map is kept in map, a writable buffer of at least
+ * GST_EDI_DIR_META_SIZE (width, height) bytes, which the meta takes
+ * over. */
+GstEdiDirMeta *
+gst_buffer_add_edi_dir_meta (GstBuffer * buffer, guint width, guint height,
+    GstBuffer * map)
+{
+  g_return_val_if_fail (GST_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (map), NULL);
+  g_return_val_if_fail (gst_buffer_get_size (map) >=
+      GST_EDI_DIR_META_SIZE (width, height), NULL);
+
+  return add_edi_dir_meta (buffer, width, height, map, GST_MAP_WRITE);
+}
@@ -0,0 +1,89 @@
+/* GStreamer
+ * Copyright (C) 2013 Rdio Inc <ingestions@rd.io>
+ * Copyright (C) 2013 David Schleef <ds@schleef.org>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_EDI_DIR_META_H_
+#define _GST_EDI_DIR_META_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_EDI_DIR_META_API_TYPE (gst_edi_dir_meta_api_get_type())
+#define GST_EDI_DIR_META_INFO (gst_edi_dir_meta_get_info())
+
+typedef struct _GstEdiDirMeta GstEdiDirMeta;
+
+/* Codes in the map.  Pixels copied from the source are 0, and so are the
+ * last column and the last two rows, which repeat it.  Interpolated
+ * pixels are GST_EDI_DIR_META_FLAT plus the CGAK direction, -5 to 5:
+ * 0 for a plain average, 1 to 5 from the steepest edge to the shallowest,
+ * negative when the edge leans back. */
+#define GST_EDI_DIR_META_SOURCE 0
+#define GST_EDI_DIR_META_FLAT 6
+
+/**
+ * GstEdiDirMeta:
+ * @meta: parent #GstMeta
+ * @width: width of the map, the luma width of the buffer
+ * @height: height of the map, the luma height of the buffer
+ * @stride: bytes per row of @data
+ * @data: the map, 4 bits per pixel, the even column in the low nibble
+ *
+ * Edge direction that ediupsample followed for every luma pixel.  Copies
+ * of the meta share @data, so it is only written before the buffer goes
+ * out.
+ */
+struct _GstEdiDirMeta
+{
+  GstMeta meta;
+
+  guint width;
+  guint height;
+  gint stride;
+  guint8 *data;
+
+  /*< private >*/
+  GstBuffer *map;
+  GstMapInfo map_info;
+};
+
+/* the bytes a map of width x height codes takes */
+#define GST_EDI_DIR_META_SIZE(width, height) (((width) + 1) / 2 * (height))
+
+GType gst_edi_dir_meta_api_get_type (void);
+const GstMetaInfo *gst_edi_dir_meta_get_info (void);
+
+#define gst_buffer_get_edi_dir_meta(b) \
+    ((GstEdiDirMeta*)gst_buffer_get_meta((b),GST_EDI_DIR_META_API_TYPE))
+
+GstEdiDirMeta *gst_buffer_add_edi_dir_meta (GstBuffer * buffer, guint width,
+    guint height, GstBuffer * map);
+
+static inline guint
+gst_edi_dir_meta_get_code (const GstEdiDirMeta * meta, guint x, guint y)
+{
+  guint8 b = meta->data[meta->stride * y + x / 2];
+
+  return (x & 1) ? b >> 4 : b & 0xf;
+}
+
+G_END_DECLS
+
+#endif
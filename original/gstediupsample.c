@@ -20,13 +20,27 @@
 /**
  * SECTION:element-gstedi
  *
- * The edi element is a test element for deinterlacing.
+ * The edi element upsamples video by the factor property, 2, 4 or 8,
+ * interpolating the new pixels along the edges in the picture rather
+ * than across them, with the method property choosing how.  With roi
+ * set, only that rectangle of the input is upsampled, and the output is
+ * factor times its size.
+ *
+ * With the deinterlace property, interleaved interlaced video keeps its
+ * size instead.  Every field becomes a progressive frame of its own,
+ * with the lines of the other field rebuilt along the edges, so the
+ * output runs at twice the frame rate, the field rate.
  *
  * <refsect2>
- * <title>Example launch line</title>
+ * <title>Example launch lines</title>
+ * |[
+ * gst-launch-1.0 -v videotestsrc ! edi factor=2 ! xvimagesink
+ * ]| Upsamples the test pattern to twice its width and height.
  * |[
- * gst-launch -v videotestsrc ! edi ! xvimageisnk
- * ]|
+ * gst-launch-1.0 -v videotestsrc ! \
+ *     video/x-raw,interlace-mode=interleaved ! \
+ *     edi deinterlace=true ! xvimagesink
+ * ]| Deinterlaces to a frame per field.
  * </refsect2>
  */
 
@@ -38,7 +52,9 @@
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
 #include <math.h>
+#include <string.h>
 #include "gstediupsample.h"
+#include "gstedidirmeta.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_edi_upsample_debug_category);
 #define GST_CAT_DEFAULT gst_edi_upsample_debug_category
@@ -55,31 +71,95 @@ static void gst_edi_upsample_finalize (GObject * object);
 
 static gboolean gst_edi_upsample_start (GstBaseTransform * trans);
 static gboolean gst_edi_upsample_stop (GstBaseTransform * trans);
+static gboolean gst_edi_upsample_src_event (GstBaseTransform * trans,
+    GstEvent * event);
+static GstFlowReturn gst_edi_upsample_generate_output (GstBaseTransform *
+    trans, GstBuffer ** outbuf);
 static GstCaps *gst_edi_upsample_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter);
 static gboolean gst_edi_upsample_set_info (GstVideoFilter * filter,
     GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
     GstVideoInfo * out_info);
+static gboolean gst_edi_upsample_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query);
+static gboolean gst_edi_upsample_decide_allocation (GstBaseTransform * trans,
+    GstQuery * query);
 static GstFlowReturn gst_edi_upsample_transform_frame (GstVideoFilter * filter,
     GstVideoFrame * inframe, GstVideoFrame * outframe);
-static GstFlowReturn gst_edi_upsample_transform_frame_cgak (GstVideoFilter *
-    filter, GstVideoFrame * inframe, GstVideoFrame * outframe);
-static GstFlowReturn gst_edi_upsample_transform_frame_dirac (GstVideoFilter *
-    filter, GstVideoFrame * inframe, GstVideoFrame * outframe);
-static GstFlowReturn gst_edi_upsample_transform_frame_bilinear (GstVideoFilter *
-    filter, GstVideoFrame * inframe, GstVideoFrame * outframe);
+static GstStructure *stats_structure (GstEdiUpsample * edi);
+static void reset_auto (GstEdiUpsample * edi);
+static void clear_dir_map_pool (GstEdiUpsample * edi);
 
 enum
 {
   PROP_0,
-  PROP_METHOD
+  PROP_METHOD,
+  PROP_N_THREADS,
+  PROP_CHROMA_MODE,
+  PROP_DIRECTION_META,
+  PROP_FACTOR,
+  PROP_SKIP_UNCHANGED,
+  PROP_PADDING,
+  PROP_INSTRUMENT,
+  PROP_STATS_INTERVAL,
+  PROP_FRAME_TIME,
+  PROP_MPIXELS_PER_SECOND,
+  PROP_STATS,
+  PROP_ROI,
+  PROP_DEINTERLACE
 };
 #define DEFAULT_METHOD GST_EDI_UPSAMPLE_METHOD_CGAK
+#define DEFAULT_N_THREADS 1
+#define DEFAULT_CHROMA_MODE GST_EDI_UPSAMPLE_CHROMA_MODE_BILINEAR
+#define DEFAULT_DIRECTION_META FALSE
+#define DEFAULT_FACTOR 2
+#define MAX_FACTOR 8
+#define DEFAULT_SKIP_UNCHANGED FALSE
+#define DEFAULT_PADDING 0
+#define MAX_PADDING 256
+#define DEFAULT_INSTRUMENT FALSE
+#define DEFAULT_STATS_INTERVAL 30
+#define DEFAULT_DEINTERLACE FALSE
+
+/* method=auto steps down this ladder under pressure, when a frame costs
+ * more than AUTO_HIGH of its duration or QoS says downstream is behind,
+ * but not within AUTO_SETTLE frames of the last step, before the cost of
+ * the new method is known.  It steps back up after auto_hold frames in a
+ * row costing less than AUTO_LOW, from AUTO_HOLD frames on and twice
+ * that, up to AUTO_MAX_HOLD, each time stepping up was followed by
+ * pressure within as many frames.  A step up lasting that long resets
+ * it.  Deinterlacing, the methods with no field pass are skipped. */
+static const GstEdiUpsampleMethod auto_methods[] = {
+  GST_EDI_UPSAMPLE_METHOD_CGAK,
+  GST_EDI_UPSAMPLE_METHOD_DIRAC,
+  GST_EDI_UPSAMPLE_METHOD_BILINEAR
+};
+
+#define AUTO_HIGH 0.9
+#define AUTO_LOW 0.5
+#define AUTO_SETTLE 8
+#define AUTO_HOLD 60
+#define AUTO_MAX_HOLD (16 * AUTO_HOLD)
+
+/* Planes and strides are asked to be aligned to this many bytes, a
+ * multiple of every vector size the row kernels use. */
+#define BUFFER_ALIGN 64
 
 /* pad templates */
 
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define HIGH_DEPTH_FORMATS \
+    "I420_10LE, I422_10LE, Y444_10LE, I420_12LE, I422_12LE, Y444_12LE, " \
+    "Y444_16LE"
+#else
+#define HIGH_DEPTH_FORMATS \
+    "I420_10BE, I422_10BE, Y444_10BE, I420_12BE, I422_12BE, Y444_12BE, " \
+    "Y444_16BE"
+#endif
+
 #define VIDEO_CAPS \
-    GST_VIDEO_CAPS_MAKE("{ I420, Y444, Y42B }")
+    GST_VIDEO_CAPS_MAKE("{ I420, Y444, Y42B, NV12, NV21, GRAY8, " \
+        "RGBx, BGRx, RGBA, BGRA, " HIGH_DEPTH_FORMATS " }")
 
 /* class initialization */
 
@@ -94,6 +174,13 @@ gst_edi_upsample_method_get_type (void)
         "cgak"},
     {GST_EDI_UPSAMPLE_METHOD_BILINEAR, "Bilinear", "bilinear"},
     {GST_EDI_UPSAMPLE_METHOD_DIRAC, "Dirac (separable 8-tap)", "dirac"},
+    {GST_EDI_UPSAMPLE_METHOD_EDI_HV,
+        "Edge-directed 6-tap, horizontal first", "edi-hv"},
+    {GST_EDI_UPSAMPLE_METHOD_EDI_VH,
+        "Edge-directed 6-tap, vertical first", "edi-vh"},
+    {GST_EDI_UPSAMPLE_METHOD_DAALA, "Daala (separable 6-tap)", "daala"},
+    {GST_EDI_UPSAMPLE_METHOD_AUTO,
+        "cgak, stepping down to dirac and bilinear under load", "auto"},
     {0, NULL, NULL},
   };
 
@@ -104,6 +191,26 @@ gst_edi_upsample_method_get_type (void)
   return edi_method_type;
 }
 
+#define GST_TYPE_EDI_CHROMA_MODE (gst_edi_upsample_chroma_mode_get_type())
+static GType
+gst_edi_upsample_chroma_mode_get_type (void)
+{
+  static GType edi_chroma_mode_type = 0;
+
+  static const GEnumValue edi_chroma_modes[] = {
+    {GST_EDI_UPSAMPLE_CHROMA_MODE_BILINEAR, "Bilinear", "bilinear"},
+    {GST_EDI_UPSAMPLE_CHROMA_MODE_LUMA_GUIDED,
+        "Along the luma edge directions (cgak only)", "luma-guided"},
+    {0, NULL, NULL},
+  };
+
+  if (!edi_chroma_mode_type) {
+    edi_chroma_mode_type =
+        g_enum_register_static ("GstEdiUpsampleChromaMode", edi_chroma_modes);
+  }
+  return edi_chroma_mode_type;
+}
+
 G_DEFINE_TYPE_WITH_CODE (GstEdiUpsample, gst_edi_upsample,
     GST_TYPE_VIDEO_FILTER,
     GST_DEBUG_CATEGORY_INIT (gst_edi_upsample_debug_category, "ediupsample", 0,
@@ -125,7 +232,8 @@ gst_edi_upsample_class_init (GstEdiUpsampleClass * klass)
           gst_caps_from_string (VIDEO_CAPS)));
 
   gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
-      "Video upsampling", "Video/Filter", "Upsample video by a factor of 2",
+      "Video upsampling", "Video/Filter",
+      "Upsample video by a factor of 2, 4 or 8",
       "David Schleef <ds@schleef.org>");
 
   gobject_class->set_property = gst_edi_upsample_set_property;
@@ -134,8 +242,16 @@ gst_edi_upsample_class_init (GstEdiUpsampleClass * klass)
   gobject_class->finalize = gst_edi_upsample_finalize;
   base_transform_class->start = GST_DEBUG_FUNCPTR (gst_edi_upsample_start);
   base_transform_class->stop = GST_DEBUG_FUNCPTR (gst_edi_upsample_stop);
+  base_transform_class->src_event =
+      GST_DEBUG_FUNCPTR (gst_edi_upsample_src_event);
+  base_transform_class->generate_output =
+      GST_DEBUG_FUNCPTR (gst_edi_upsample_generate_output);
   base_transform_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_edi_upsample_transform_caps);
+  base_transform_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_edi_upsample_propose_allocation);
+  base_transform_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_edi_upsample_decide_allocation);
   video_filter_class->set_info = GST_DEBUG_FUNCPTR (gst_edi_upsample_set_info);
   video_filter_class->transform_frame =
       GST_DEBUG_FUNCPTR (gst_edi_upsample_transform_frame);
@@ -144,11 +260,95 @@ gst_edi_upsample_class_init (GstEdiUpsampleClass * klass)
       g_param_spec_enum ("method", "method", "method",
           GST_TYPE_EDI_METHOD, DEFAULT_METHOD,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_N_THREADS,
+      g_param_spec_uint ("n-threads", "Threads",
+          "Maximum number of threads to use (0 = number of processors)",
+          0, G_MAXINT, DEFAULT_N_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_CHROMA_MODE,
+      g_param_spec_enum ("chroma-mode", "Chroma mode",
+          "How to interpolate the chroma planes",
+          GST_TYPE_EDI_CHROMA_MODE, DEFAULT_CHROMA_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DIRECTION_META,
+      g_param_spec_boolean ("direction-meta", "Direction meta",
+          "Attach the edge direction of every output pixel as a GstEdiDirMeta "
+          "(cgak only)", DEFAULT_DIRECTION_META,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FACTOR,
+      g_param_spec_uint ("factor", "Factor",
+          "Upsampling factor, done as a cascade of 2x steps (2, 4 or 8)",
+          2, MAX_FACTOR, DEFAULT_FACTOR,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_SKIP_UNCHANGED,
+      g_param_spec_boolean ("skip-unchanged", "Skip unchanged",
+          "Copy the output of rows that did not change since the previous "
+          "frame from the previous output (not with direction-meta)",
+          DEFAULT_SKIP_UNCHANGED, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PADDING,
+      g_param_spec_uint ("padding", "Padding",
+          "Border of output pixels around the picture, filled with its edge "
+          "pixels (needs GstVideoMeta downstream)",
+          0, MAX_PADDING, DEFAULT_PADDING,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_INSTRUMENT,
+      g_param_spec_boolean ("instrument", "Instrument",
+          "Measure the processing time of every frame, and count the CGAK "
+          "directions of its luma (cgak only)", DEFAULT_INSTRUMENT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_STATS_INTERVAL,
+      g_param_spec_uint ("stats-interval", "Stats interval",
+          "Post the stats as an element message every this many frames "
+          "while instrumenting (0 = never)", 0, G_MAXUINT,
+          DEFAULT_STATS_INTERVAL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_FRAME_TIME,
+      g_param_spec_uint64 ("frame-time", "Frame time",
+          "Processing time of the last frame in nanoseconds, while "
+          "instrumenting", 0, G_MAXUINT64, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_MPIXELS_PER_SECOND,
+      g_param_spec_double ("mpixels-per-second", "Megapixels per second",
+          "Output megapixels per second of processing over the last frames, "
+          "while instrumenting", 0, G_MAXDOUBLE, 0,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Stats",
+          "The measurements of the last frame, with the number of "
+          "interpolated luma pixels per CGAK direction -5 to 5 in "
+          "\"directions\" (0 is the flat average)", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_ROI,
+      gst_param_spec_array ("roi", "Region of interest",
+          "Only upsample the rectangle <x, y, width, height> of the input, "
+          "or of its GstVideoCropMeta, and output that size (<> = all)",
+          g_param_spec_int ("coordinate", "Coordinate", "Coordinate",
+              0, G_MAXINT, 0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS),
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_DEINTERLACE,
+      g_param_spec_boolean ("deinterlace", "Deinterlace",
+          "Take interleaved fields and output a frame per field, of the same "
+          "size, with the lines of the other field rebuilt along the edges "
+          "(averaged with method=bilinear; not with factor or roi)",
+          DEFAULT_DEINTERLACE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  GST_INFO ("using %s kernels", edi_get_simd_name ());
 }
 
 static void
 gst_edi_upsample_init (GstEdiUpsample * edi)
 {
+  edi->method = DEFAULT_METHOD;
+  edi->n_threads = DEFAULT_N_THREADS;
+  edi->chroma_mode = DEFAULT_CHROMA_MODE;
+  edi->direction_meta = DEFAULT_DIRECTION_META;
+  edi->factor = DEFAULT_FACTOR;
+  edi->skip_unchanged = DEFAULT_SKIP_UNCHANGED;
+  edi->padding = DEFAULT_PADDING;
+  edi->instrument = DEFAULT_INSTRUMENT;
+  edi->stats_interval = DEFAULT_STATS_INTERVAL;
+  edi->deinterlace = DEFAULT_DEINTERLACE;
+  edi->n_stages = 1;
+  edi->auto_hold = AUTO_HOLD;
 }
 
 void
@@ -161,7 +361,82 @@ gst_edi_upsample_set_property (GObject * object, guint property_id,
 
   switch (property_id) {
     case PROP_METHOD:
+      /* the next frame starts method=auto over */
+      GST_OBJECT_LOCK (edi);
       edi->method = g_value_get_enum (value);
+      edi->auto_reset = TRUE;
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (edi);
+      edi->n_threads = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_CHROMA_MODE:
+      edi->chroma_mode = g_value_get_enum (value);
+      break;
+    case PROP_DIRECTION_META:
+      edi->direction_meta = g_value_get_boolean (value);
+      break;
+    case PROP_FACTOR:{
+      guint factor = g_value_get_uint (value);
+
+      /* only powers of two can be cascaded */
+      if (factor & (factor - 1)) {
+        factor = 1 << g_bit_nth_msf (factor, -1);
+        GST_WARNING_OBJECT (edi, "factor %u is not a power of two, using %u",
+            g_value_get_uint (value), factor);
+      }
+      GST_OBJECT_LOCK (edi);
+      edi->factor = factor;
+      GST_OBJECT_UNLOCK (edi);
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (edi));
+      break;
+    }
+    case PROP_SKIP_UNCHANGED:
+      edi->skip_unchanged = g_value_get_boolean (value);
+      break;
+    case PROP_PADDING:
+      GST_OBJECT_LOCK (edi);
+      edi->padding = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (edi);
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (edi));
+      break;
+    case PROP_INSTRUMENT:
+      GST_OBJECT_LOCK (edi);
+      edi->instrument = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (edi);
+      edi->stats_interval = g_value_get_uint (value);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_ROI:{
+      GstVideoRectangle roi = { 0, };
+
+      if (gst_value_array_get_size (value) == 4) {
+        roi.x = g_value_get_int (gst_value_array_get_value (value, 0));
+        roi.y = g_value_get_int (gst_value_array_get_value (value, 1));
+        roi.w = g_value_get_int (gst_value_array_get_value (value, 2));
+        roi.h = g_value_get_int (gst_value_array_get_value (value, 3));
+      } else if (gst_value_array_get_size (value) != 0) {
+        GST_WARNING_OBJECT (edi, "the roi takes 4 values, not %u",
+            gst_value_array_get_size (value));
+      }
+      if (roi.w == 0 || roi.h == 0)
+        roi.w = roi.h = 0;
+      GST_OBJECT_LOCK (edi);
+      edi->roi = roi;
+      GST_OBJECT_UNLOCK (edi);
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (edi));
+      break;
+    }
+    case PROP_DEINTERLACE:
+      GST_OBJECT_LOCK (edi);
+      edi->deinterlace = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (edi);
+      gst_base_transform_reconfigure_src (GST_BASE_TRANSFORM (edi));
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -179,7 +454,85 @@ gst_edi_upsample_get_property (GObject * object, guint property_id,
 
   switch (property_id) {
     case PROP_METHOD:
+      GST_OBJECT_LOCK (edi);
       g_value_set_enum (value, edi->method);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_N_THREADS:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_uint (value, edi->n_threads);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_CHROMA_MODE:
+      g_value_set_enum (value, edi->chroma_mode);
+      break;
+    case PROP_DIRECTION_META:
+      g_value_set_boolean (value, edi->direction_meta);
+      break;
+    case PROP_FACTOR:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_uint (value, edi->factor);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_SKIP_UNCHANGED:
+      g_value_set_boolean (value, edi->skip_unchanged);
+      break;
+    case PROP_PADDING:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_uint (value, edi->padding);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_INSTRUMENT:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_boolean (value, edi->instrument);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_STATS_INTERVAL:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_uint (value, edi->stats_interval);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_FRAME_TIME:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_uint64 (value, edi->frame_time);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_MPIXELS_PER_SECOND:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_double (value, edi->mpixels_per_second);
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (edi);
+      g_value_take_boxed (value, stats_structure (edi));
+      GST_OBJECT_UNLOCK (edi);
+      break;
+    case PROP_ROI:{
+      GValue v = G_VALUE_INIT;
+      GstVideoRectangle roi;
+
+      GST_OBJECT_LOCK (edi);
+      roi = edi->roi;
+      GST_OBJECT_UNLOCK (edi);
+
+      if (roi.w > 0) {
+        g_value_init (&v, G_TYPE_INT);
+        g_value_set_int (&v, roi.x);
+        gst_value_array_append_value (value, &v);
+        g_value_set_int (&v, roi.y);
+        gst_value_array_append_value (value, &v);
+        g_value_set_int (&v, roi.w);
+        gst_value_array_append_value (value, &v);
+        g_value_set_int (&v, roi.h);
+        gst_value_array_append_value (value, &v);
+        g_value_unset (&v);
+      }
+      break;
+    }
+    case PROP_DEINTERLACE:
+      GST_OBJECT_LOCK (edi);
+      g_value_set_boolean (value, edi->deinterlace);
+      GST_OBJECT_UNLOCK (edi);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -207,6 +560,11 @@ gst_edi_upsample_finalize (GObject * object)
   GST_DEBUG_OBJECT (edi, "finalize");
 
   /* clean up object here */
+  g_clear_pointer (&edi->upsampler, edi_upsampler_free);
+  clear_dir_map_pool (edi);
+  gst_buffer_replace (&edi->prev_inbuf, NULL);
+  gst_buffer_replace (&edi->prev_outbuf, NULL);
+  gst_buffer_replace (&edi->field_buf, NULL);
 
   G_OBJECT_CLASS (gst_edi_upsample_parent_class)->finalize (object);
 }
@@ -218,6 +576,8 @@ gst_edi_upsample_start (GstBaseTransform * trans)
 
   GST_DEBUG_OBJECT (edi, "start");
 
+  reset_auto (edi);
+
   return TRUE;
 }
 
@@ -228,42 +588,153 @@ gst_edi_upsample_stop (GstBaseTransform * trans)
 
   GST_DEBUG_OBJECT (edi, "stop");
 
+  g_clear_pointer (&edi->upsampler, edi_upsampler_free);
+  clear_dir_map_pool (edi);
+  gst_buffer_replace (&edi->prev_inbuf, NULL);
+  gst_buffer_replace (&edi->prev_outbuf, NULL);
+  gst_buffer_replace (&edi->field_buf, NULL);
+
+  GST_OBJECT_LOCK (edi);
+  edi->n_frames = 0;
+  edi->frame_time = 0;
+  edi->avg_frame_time = 0;
+  edi->mpixels_per_second = 0;
+  edi->have_dir_counts = FALSE;
+  GST_OBJECT_UNLOCK (edi);
+
   return TRUE;
 }
 
+static gboolean
+gst_edi_upsample_src_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (trans);
+
+  GST_DEBUG_OBJECT (edi, "src_event");
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_QOS) {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+
+    gst_event_parse_qos (event, &type, &proportion, &diff, NULL);
+    if (type != GST_QOS_TYPE_THROTTLE && (proportion > 1.0 || diff > 0)) {
+      GST_OBJECT_LOCK (edi);
+      edi->qos_late = TRUE;
+      GST_OBJECT_UNLOCK (edi);
+    }
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (gst_edi_upsample_parent_class)->
+      src_event (trans, event);
+}
+
+/* Multiplies a size by 1 << shift when dir, otherwise divides it.  Sizes
+ * that would go past G_MAXINT stop at the largest multiple of the range
+ * step below it. */
 static void
-transform_value (GValue * value, gboolean dir)
+transform_value (GValue * value, gboolean dir, int shift)
 {
   if (G_VALUE_HOLDS_INT (value)) {
     int val = g_value_get_int (value);
-    val = dir ? (val << 1) : (val >> 1);
+    val = dir ? (MIN (val, G_MAXINT >> shift) << shift) : (val >> shift);
     g_value_set_int (value, val);
   } else if (GST_VALUE_HOLDS_INT_RANGE (value)) {
     int min = gst_value_get_int_range_min (value);
     int max = gst_value_get_int_range_max (value);
     int step = gst_value_get_int_range_step (value);
 
-    min = dir ? (min << 1) : (min >> 1);
-    max = dir ? (max << 1) : (max >> 1);
-    step = dir ? (step << 1) : (step >> 1);
-    if (step == 0)
-      step = 1;
+    if (dir) {
+      int limit = (G_MAXINT >> shift) / step * step;
+
+      min = MIN (min, limit) << shift;
+      max = MIN (max, limit) << shift;
+      step <<= shift;
+    } else {
+      min >>= shift;
+      max >>= shift;
+      step >>= shift;
+      if (step == 0)
+        step = 1;
+    }
 
-    gst_value_set_int_range_step (value, min, max, step);
+    if (min < max) {
+      gst_value_set_int_range_step (value, min, max, step);
+    } else {
+      g_value_unset (value);
+      g_value_init (value, G_TYPE_INT);
+      g_value_set_int (value, min);
+    }
   } else {
     GST_ERROR ("unhandled value type %s", g_type_name (G_VALUE_TYPE (value)));
   }
 }
 
+/* Doubles a frame rate n / d when dir, otherwise halves it, up to the
+ * largest or smallest there is. */
+static void
+transform_rate (int *n, int *d, gboolean dir)
+{
+  if (!gst_util_fraction_multiply (*n, *d, dir ? 2 : 1, dir ? 1 : 2, n, d)) {
+    *n = dir ? G_MAXINT : 1;
+    *d = dir ? 1 : G_MAXINT;
+  }
+}
+
+/* Turns the caps of interleaved fields into those of a frame per field
+ * when dir, and back otherwise. */
+static void
+transform_fields (GstStructure * structure, gboolean dir)
+{
+  const GValue *value = gst_structure_get_value (structure, "framerate");
+  int n, d, n2, d2;
+
+  if (value && GST_VALUE_HOLDS_FRACTION (value)) {
+    n = gst_value_get_fraction_numerator (value);
+    d = gst_value_get_fraction_denominator (value);
+    transform_rate (&n, &d, dir);
+    gst_structure_set (structure, "framerate", GST_TYPE_FRACTION, n, d,
+        NULL);
+  } else if (value && GST_VALUE_HOLDS_FRACTION_RANGE (value)) {
+    const GValue *min = gst_value_get_fraction_range_min (value);
+    const GValue *max = gst_value_get_fraction_range_max (value);
+
+    n = gst_value_get_fraction_numerator (min);
+    d = gst_value_get_fraction_denominator (min);
+    n2 = gst_value_get_fraction_numerator (max);
+    d2 = gst_value_get_fraction_denominator (max);
+    transform_rate (&n, &d, dir);
+    transform_rate (&n2, &d2, dir);
+    gst_structure_set (structure, "framerate", GST_TYPE_FRACTION_RANGE,
+        n, d, n2, d2, NULL);
+  } else if (value) {
+    GST_ERROR ("unhandled value type %s", g_type_name (G_VALUE_TYPE (value)));
+  }
+
+  gst_structure_set (structure, "interlace-mode", G_TYPE_STRING,
+      dir ? "progressive" : "interleaved", NULL);
+  if (dir)
+    gst_structure_remove_field (structure, "field-order");
+}
+
 static GstCaps *
 gst_edi_upsample_transform_caps (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
 {
   GstEdiUpsample *edi = GST_EDI_UPSAMPLE (trans);
+  GstVideoRectangle roi;
   GstCaps *othercaps;
+  gboolean deinterlace;
+  int shift;
 
   GST_DEBUG_OBJECT (edi, "transform_caps");
 
+  GST_OBJECT_LOCK (edi);
+  shift = g_bit_nth_msf (edi->factor, -1);
+  roi = edi->roi;
+  deinterlace = edi->deinterlace;
+  GST_OBJECT_UNLOCK (edi);
+
   othercaps = gst_caps_copy (caps);
 
   /* Copy other caps and modify as appropriate */
@@ -276,12 +747,25 @@ gst_edi_upsample_transform_caps (GstBaseTransform * trans,
 
     for (i = 0; i < gst_caps_get_size (othercaps); i++) {
       GstStructure *structure = gst_caps_get_structure (othercaps, i);
+
+      /* the same size at half the rate */
+      if (deinterlace) {
+        transform_fields (structure, FALSE);
+        continue;
+      }
+      /* any input the roi fits in */
+      if (roi.w > 0) {
+        gst_structure_set (structure,
+            "width", GST_TYPE_INT_RANGE, roi.x + roi.w, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, roi.y + roi.h, G_MAXINT, NULL);
+        continue;
+      }
       value = (GValue *) gst_structure_get_value (structure, "width");
       if (value)
-        transform_value (value, FALSE);
+        transform_value (value, FALSE, shift);
       value = (GValue *) gst_structure_get_value (structure, "height");
       if (value)
-        transform_value (value, FALSE);
+        transform_value (value, FALSE, shift);
     }
 
     /* transform caps going upstream */
@@ -291,12 +775,23 @@ gst_edi_upsample_transform_caps (GstBaseTransform * trans,
 
     for (i = 0; i < gst_caps_get_size (othercaps); i++) {
       GstStructure *structure = gst_caps_get_structure (othercaps, i);
+
+      if (deinterlace) {
+        transform_fields (structure, TRUE);
+        continue;
+      }
+      if (roi.w > 0) {
+        gst_structure_set (structure,
+            "width", G_TYPE_INT, roi.w << shift,
+            "height", G_TYPE_INT, roi.h << shift, NULL);
+        continue;
+      }
       value = (GValue *) gst_structure_get_value (structure, "width");
       if (value)
-        transform_value (value, TRUE);
+        transform_value (value, TRUE, shift);
       value = (GValue *) gst_structure_get_value (structure, "height");
       if (value)
-        transform_value (value, TRUE);
+        transform_value (value, TRUE, shift);
     }
 
     /* transform caps going downstream */
@@ -319,462 +814,593 @@ gst_edi_upsample_set_info (GstVideoFilter * filter, GstCaps * incaps,
     GstVideoInfo * in_info, GstCaps * outcaps, GstVideoInfo * out_info)
 {
   GstEdiUpsample *edi = GST_EDI_UPSAMPLE (filter);
+  int width = GST_VIDEO_INFO_WIDTH (in_info);
+  int height = GST_VIDEO_INFO_HEIGHT (in_info);
+  GstVideoRectangle roi;
+  int n_stages;
 
   GST_DEBUG_OBJECT (edi, "set_info");
 
-  return TRUE;
+  /* frames of other caps are no use to compare with */
+  gst_buffer_replace (&edi->prev_inbuf, NULL);
+  gst_buffer_replace (&edi->prev_outbuf, NULL);
+  gst_buffer_replace (&edi->field_buf, NULL);
+
+  /* deinterlacing keeps the size */
+  edi->deinterlacing = GST_VIDEO_INFO_INTERLACE_MODE (in_info) ==
+      GST_VIDEO_INTERLACE_MODE_INTERLEAVED &&
+      !GST_VIDEO_INFO_IS_INTERLACED (out_info) &&
+      width == GST_VIDEO_INFO_WIDTH (out_info) &&
+      height == GST_VIDEO_INFO_HEIGHT (out_info);
+  if (edi->deinterlacing) {
+    edi->out_roi.w = edi->out_roi.h = 0;
+    return TRUE;
+  }
+
+  GST_OBJECT_LOCK (edi);
+  roi = edi->roi;
+  GST_OBJECT_UNLOCK (edi);
+  if (roi.x + roi.w > width || roi.y + roi.h > height) {
+    GST_WARNING_OBJECT (edi, "roi %dx%d at %d,%d is outside %dx%d",
+        roi.w, roi.h, roi.x, roi.y, width, height);
+    roi.w = roi.h = 0;
+  }
+
+  /* the factor and the roi may have changed since these caps were made,
+   * so go by the caps themselves */
+  for (n_stages = 1; (1 << n_stages) <= MAX_FACTOR; n_stages++) {
+    if (width << n_stages == GST_VIDEO_INFO_WIDTH (out_info) &&
+        height << n_stages == GST_VIDEO_INFO_HEIGHT (out_info)) {
+      edi->n_stages = n_stages;
+      edi->out_roi.w = edi->out_roi.h = 0;
+      return TRUE;
+    }
+    if (roi.w > 0 && roi.w << n_stages == GST_VIDEO_INFO_WIDTH (out_info) &&
+        roi.h << n_stages == GST_VIDEO_INFO_HEIGHT (out_info)) {
+      edi->n_stages = n_stages;
+      edi->out_roi = roi;
+      return TRUE;
+    }
+  }
+
+  GST_ERROR_OBJECT (edi, "cannot upsample %dx%d to %dx%d",
+      GST_VIDEO_INFO_WIDTH (in_info), GST_VIDEO_INFO_HEIGHT (in_info),
+      GST_VIDEO_INFO_WIDTH (out_info), GST_VIDEO_INFO_HEIGHT (out_info));
+  return FALSE;
 }
 
+/* Fills align with aligned strides for info and a border of padding
+ * pixels, rounded up so that every component gets the border edi.c
+ * writes for it.  Returns the rounded padding. */
 static int
-reconstruct_v (guint8 * src, int stride, int a, int b, int c, int d)
-{
-  int x;
-
-  x = src[0 - 3 * stride] * a;
-  x += src[0 - 2 * stride] * b;
-  x += src[0 - 1 * stride] * c;
-  x += src[0 - 0 * stride] * d;
-  x += src[1 + 0 * stride] * d;
-  x += src[1 + 1 * stride] * c;
-  x += src[1 + 2 * stride] * b;
-  x += src[1 + 3 * stride] * a;
-  return (x + 16) >> 5;
+set_alignment (GstVideoAlignment * align, GstVideoInfo * info, int padding)
+{
+  guint k, sub = 0;
+
+  for (k = 0; k < GST_VIDEO_INFO_N_COMPONENTS (info); k++) {
+    sub = MAX (sub, GST_VIDEO_FORMAT_INFO_W_SUB (info->finfo, k));
+    sub = MAX (sub, GST_VIDEO_FORMAT_INFO_H_SUB (info->finfo, k));
+  }
+  padding = GST_ROUND_UP_N (padding, 1 << sub);
+
+  gst_video_alignment_reset (align);
+  align->padding_top = align->padding_bottom = padding;
+  align->padding_left = align->padding_right = padding;
+  for (k = 0; k < GST_VIDEO_MAX_PLANES; k++)
+    align->stride_align[k] = BUFFER_ALIGN - 1;
+
+  return padding;
 }
 
-static int
-reconstruct_h (guint8 * d1, guint8 * d2, int a, int b, int c, int d)
-{
-  int x;
-
-  x = d1[-3] * a;
-  x += d1[-2] * b;
-  x += d1[-1] * c;
-  x += d1[-0] * d;
-  x += d2[0] * d;
-  x += d2[1] * c;
-  x += d2[2] * b;
-  x += d2[3] * a;
-  return (x + 16) >> 5;
+static gboolean
+gst_edi_upsample_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (trans);
+  GstAllocationParams params;
+  GstVideoAlignment align;
+  GstStructure *config;
+  GstBufferPool *pool;
+  GstVideoInfo info;
+  GstCaps *caps;
+  guint size;
+
+  GST_DEBUG_OBJECT (edi, "propose_allocation");
+
+  gst_query_parse_allocation (query, &caps, NULL);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  gst_allocation_params_init (&params);
+  params.align = BUFFER_ALIGN - 1;
+
+  if (gst_query_get_n_allocation_pools (query) == 0) {
+    pool = gst_video_buffer_pool_new ();
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, info.size, 0, 0);
+    gst_buffer_pool_config_set_allocator (config, NULL, &params);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+    set_alignment (&align, &info, 0);
+    gst_buffer_pool_config_set_video_alignment (config, &align);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      GST_ERROR_OBJECT (edi, "failed to configure the proposed pool");
+      gst_object_unref (pool);
+      return FALSE;
+    }
+
+    /* the pool computed the size of the aligned frames */
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL);
+    gst_structure_free (config);
+
+    gst_query_add_allocation_pool (query, pool, size, 0, 0);
+    gst_object_unref (pool);
+  }
+  gst_query_add_allocation_param (query, NULL, &params);
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  /* only what is visible gets upsampled, though fields are always
+   * deinterlaced whole */
+  if (!edi->deinterlacing)
+    gst_query_add_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE,
+        NULL);
+
+  return TRUE;
 }
 
-static GstFlowReturn
-gst_edi_upsample_transform_frame_cgak (GstVideoFilter * filter,
-    GstVideoFrame * inframe, GstVideoFrame * outframe)
+/* Takes the pool downstream offers, or a video pool of our own, and
+ * asks for aligned memory.  Strides and the border can only be chosen
+ * when downstream reads the layout from a GstVideoMeta. */
+static gboolean
+gst_edi_upsample_decide_allocation (GstBaseTransform * trans,
+    GstQuery * query)
 {
-  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (filter);
-  int k;
-  int i, j;
-  guint8 *src_data;
-  int src_stride;
-  int src_width;
-  int src_height;
-  guint8 *dest_data;
-  int dest_stride;
+  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (trans);
+  GstAllocator *allocator = NULL;
+  GstAllocationParams params;
+  GstVideoAlignment align;
+  GstStructure *config;
+  GstBufferPool *pool = NULL;
+  GstVideoInfo info;
+  GstCaps *outcaps;
+  guint size, min, max;
+  gboolean update_pool, video_meta;
+  int wanted = 0, padding = 0;
+
+  GST_DEBUG_OBJECT (edi, "decide_allocation");
+
+  gst_query_parse_allocation (query, &outcaps, NULL);
+  if (outcaps == NULL || !gst_video_info_from_caps (&info, outcaps))
+    return FALSE;
+
+  if (gst_query_get_n_allocation_params (query) > 0) {
+    gst_query_parse_nth_allocation_param (query, 0, &allocator, &params);
+  } else {
+    gst_allocation_params_init (&params);
+  }
+  params.align |= BUFFER_ALIGN - 1;
 
-  GST_DEBUG_OBJECT (edi, "transform_frame");
+  update_pool = gst_query_get_n_allocation_pools (query) > 0;
+  if (update_pool) {
+    gst_query_parse_nth_allocation_pool (query, 0, &pool, &size, &min, &max);
+  } else {
+    size = info.size;
+    min = max = 0;
+  }
 
-  for (k = 0; k < 1; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-#define MARGIN 3
-    for (j = 0; j < src_height; j++) {
-      guint8 *s = src_data + src_stride * j;
-      guint8 *d = dest_data + dest_stride * 2 * j;
-
-      if (j >= MARGIN && j < src_height - MARGIN - 1) {
-        for (i = 0; i < src_width - 1; i++) {
-          int dx, dy, dx2;
-          int v;
-
-          dx = -s[-src_stride + i]
-              - s[-src_stride + i + 1]
-              + s[src_stride + i]
-              + s[src_stride + i + 1];
-          dx *= 2;
-
-          dy = -s[-src_stride + i]
-              - 2 * s[i]
-              - s[src_stride + i]
-              + s[-src_stride + i + 1]
-              + 2 * s[i + 1]
-              + s[src_stride + i + 1];
-
-          dx2 = -s[-src_stride + i]
-              + 2 * s[i]
-              - s[src_stride + i]
-              - s[-src_stride + i + 1]
-              + 2 * s[i + 1]
-              - s[src_stride + i + 1];
-
-          if (dy < 0) {
-            dy = -dy;
-            dx = -dx;
-          }
-
-          if (ABS (dx) <= 4 * ABS (dx2)) {
-            v = (s[i] + s[i + 1] + 1) >> 1;
-          } else if (dx < 0) {
-            if (dx < -2 * dy) {
-              v = reconstruct_v (s + i, src_stride, 0, 0, 0, 16);
-            } else if (dx < -dy) {
-              v = reconstruct_v (s + i, src_stride, 0, 0, 8, 8);
-            } else if (2 * dx < -dy) {
-              v = reconstruct_v (s + i, src_stride, 0, 4, 8, 4);
-            } else if (3 * dx < -dy) {
-              v = reconstruct_v (s + i, src_stride, 1, 7, 7, 1);
-            } else {
-              v = reconstruct_v (s + i, src_stride, 4, 8, 4, 0);
-            }
-          } else {
-            if (dx > 2 * dy) {
-              v = reconstruct_v (s + i, -src_stride, 0, 0, 0, 16);
-            } else if (dx > dy) {
-              v = reconstruct_v (s + i, -src_stride, 0, 0, 8, 8);
-            } else if (2 * dx > dy) {
-              v = reconstruct_v (s + i, -src_stride, 0, 4, 8, 4);
-            } else if (3 * dx > dy) {
-              v = reconstruct_v (s + i, -src_stride, 1, 7, 7, 1);
-            } else {
-              v = reconstruct_v (s + i, -src_stride, 4, 8, 4, 0);
-            }
-          }
-          d[i * 2] = s[i];
-          d[i * 2 + 1] = CLAMP (v, 0, 255);
-        }
-        d[i * 2] = s[i];
-        d[i * 2 + 1] = s[i];
-      } else {
-        guint8 *s = src_data + src_stride * j;
-        guint8 *d1 = dest_data + dest_stride * 2 * j;
-        guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-
-        for (i = 0; i < src_width - 1; i++) {
-          d1[i * 2] = s[i];
-          d1[i * 2 + 1] = (s[i] + s[i + 1] + 1) >> 1;
-          d2[i * 2] = s[i];
-          d2[i * 2 + 1] = (s[i] + s[i + 1] + 1) >> 1;
-        }
-        d1[i * 2] = s[i];
-        d1[i * 2 + 1] = s[i];
-        d2[i * 2] = s[i];
-        d2[i * 2 + 1] = s[i];
-      }
-    }
-    for (j = 0; j < src_height - 1; j++) {
-      guint8 *d1 = dest_data + dest_stride * 2 * j;
-      guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-      guint8 *d3 = dest_data + dest_stride * (2 * j + 2);
-
-      for (i = 0; i < src_width * 2; i++) {
-        if (i >= MARGIN && i < src_width * 2 - MARGIN - 1) {
-          int dx, dy;
-          int dx2;
-          int v;
-
-          dx = -d1[i - 1]
-              - d3[i - 1]
-              + d1[i + 1]
-              + d3[i + 1];
-          dx *= 2;
-
-          dy = -d1[i - 1]
-              - 2 * d1[i]
-              - d1[i + 1]
-              + d3[i - 1]
-              + 2 * d3[i]
-              + d3[i + 1];
-
-          dx2 = -d1[i - 1]
-              + 2 * d1[i]
-              - d1[i + 1]
-              - d3[i - 1]
-              + 2 * d3[i]
-              - d3[i + 1];
-
-          if (dy < 0) {
-            dy = -dy;
-            dx = -dx;
-          }
-
-          if (ABS (dx) <= 4 * ABS (dx2)) {
-            v = (d1[i] + d3[i] + 1) >> 1;
-          } else if (dx < 0) {
-            if (dx < -2 * dy) {
-              v = reconstruct_h (d1 + i, d3 + i, 0, 0, 0, 16);
-            } else if (dx < -dy) {
-              v = reconstruct_h (d1 + i, d3 + i, 0, 0, 8, 8);
-            } else if (2 * dx < -dy) {
-              v = reconstruct_h (d1 + i, d3 + i, 0, 4, 8, 4);
-            } else if (3 * dx < -dy) {
-              v = reconstruct_h (d1 + i, d3 + i, 1, 7, 7, 1);
-            } else {
-              v = reconstruct_h (d1 + i, d3 + i, 4, 8, 4, 0);
-            }
-          } else {
-            if (dx > 2 * dy) {
-              v = reconstruct_h (d3 + i, d1 + i, 0, 0, 0, 16);
-            } else if (dx > dy) {
-              v = reconstruct_h (d3 + i, d1 + i, 0, 0, 8, 8);
-            } else if (2 * dx > dy) {
-              v = reconstruct_h (d3 + i, d1 + i, 0, 4, 8, 4);
-            } else if (3 * dx > dy) {
-              v = reconstruct_h (d3 + i, d1 + i, 1, 7, 7, 1);
-            } else {
-              v = reconstruct_h (d3 + i, d1 + i, 4, 8, 4, 0);
-            }
-          }
-          d2[i] = CLAMP (v, 0, 255);
-        } else {
-          d2[i] = (d1[i] + d3[i] + 1) >> 1;
-        }
-      }
-    }
-    {
-      guint8 *d1 = dest_data + dest_stride * 2 * j;
-      guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-
-      for (i = 0; i < src_width; i++) {
-        d1[2 * i + 1] = d1[i * 2];
-        d2[2 * i] = d1[i * 2];
-        d2[2 * i + 1] = d1[i * 2];
-      }
+  video_meta =
+      gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  if (video_meta) {
+    GST_OBJECT_LOCK (edi);
+    wanted = edi->padding;
+    GST_OBJECT_UNLOCK (edi);
+  }
+
+  /* padded buffers need a pool that can put a GstVideoMeta on them and
+   * align them; the default pool can */
+  if (pool != NULL && wanted > 0 && (!gst_buffer_pool_has_option (pool,
+              GST_BUFFER_POOL_OPTION_VIDEO_META) ||
+          !gst_buffer_pool_has_option (pool,
+              GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT))) {
+    GST_DEBUG_OBJECT (edi, "downstream pool cannot pad, using our own");
+    gst_object_unref (pool);
+    pool = NULL;
+  }
+  if (pool == NULL)
+    pool = gst_video_buffer_pool_new ();
+
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, outcaps, size, min, max);
+  gst_buffer_pool_config_set_allocator (config, allocator, &params);
+  if (video_meta && gst_buffer_pool_has_option (pool,
+          GST_BUFFER_POOL_OPTION_VIDEO_META)) {
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+    if (gst_buffer_pool_has_option (pool,
+            GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+      padding = set_alignment (&align, &info, wanted);
+      gst_buffer_pool_config_add_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+      gst_buffer_pool_config_set_video_alignment (config, &align);
     }
   }
-  for (k = 1; k < 3; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-    for (j = 0; j < src_height; j++) {
-      guint8 *s1 = src_data + src_stride * j;
-      guint8 *s2 = src_data + src_stride * (j + 1);
-      guint8 *d1 = dest_data + dest_stride * 2 * j;
-      guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-
-      if (j < src_height - 1) {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = (s1[i] + s2[i] + 1) >> 1;
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + s2[i] + s2[i + 1] + 2) >> 2;
-        }
-      } else {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = s1[i];
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-        }
-      }
+
+  /* a pool that wants other settings says so in the config it leaves */
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    config = gst_buffer_pool_get_config (pool);
+    if (!gst_buffer_pool_config_validate_params (config, outcaps, size, min,
+            max) || !gst_buffer_pool_set_config (pool, config)) {
+      GST_ERROR_OBJECT (edi, "failed to configure the output pool");
+      if (allocator)
+        gst_object_unref (allocator);
+      gst_object_unref (pool);
+      return FALSE;
     }
   }
 
-  return GST_FLOW_OK;
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_get_params (config, NULL, &size, NULL, NULL);
+  if (padding > 0 && (!gst_buffer_pool_config_has_option (config,
+              GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT) ||
+          !gst_buffer_pool_config_get_video_alignment (config, &align) ||
+          align.padding_top < (guint) padding ||
+          align.padding_left < (guint) padding))
+    padding = 0;
+  gst_structure_free (config);
+
+  if (padding == 0 && wanted > 0)
+    GST_WARNING_OBJECT (edi, "downstream cannot take padded buffers");
+  edi->out_padding = padding;
+
+  if (update_pool) {
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  } else {
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+  }
+  if (gst_query_get_n_allocation_params (query) > 0) {
+    gst_query_set_nth_allocation_param (query, 0, allocator, &params);
+  } else {
+    gst_query_add_allocation_param (query, allocator, &params);
+  }
+  if (allocator)
+    gst_object_unref (allocator);
+  gst_object_unref (pool);
+
+  return GST_BASE_TRANSFORM_CLASS (gst_edi_upsample_parent_class)->
+      decide_allocation (trans, query);
 }
 
-static GstFlowReturn
-gst_edi_upsample_transform_frame_dirac (GstVideoFilter * filter,
-    GstVideoFrame * inframe, GstVideoFrame * outframe)
+/* Describes a mapped frame to edi.c. */
+static void
+image_from_frame (EdiImage * img, GstVideoFrame * frame)
 {
-  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (filter);
+  const GstVideoFormatInfo *finfo = frame->info.finfo;
   int k;
-  int i, j;
-  guint8 *src_data;
-  int src_stride;
-  int src_width;
-  int src_height;
-  guint8 *dest_data;
-  int dest_stride;
 
-  GST_DEBUG_OBJECT (edi, "transform_frame");
+  img->depth = GST_VIDEO_FORMAT_INFO_DEPTH (finfo, 0);
+  for (k = 0; k < 3; k++)
+    img->rgb_offset[k] = GST_VIDEO_FORMAT_INFO_POFFSET (finfo, k);
+
+  if (GST_VIDEO_FORMAT_INFO_IS_RGB (finfo)) {
+    img->n_components = 1;
+    img->channels = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
+    img->data[0] = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+    img->stride[0] = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+    img->pstride[0] = img->channels;
+    img->width[0] = GST_VIDEO_FRAME_WIDTH (frame);
+    img->height[0] = GST_VIDEO_FRAME_HEIGHT (frame);
+    img->x_shift[0] = img->y_shift[0] = 0;
+    return;
+  }
 
-  for (k = 0; k < 1; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-#define MARGIN 3
-    for (j = 0; j < src_height; j++) {
-      guint8 *s = src_data + src_stride * j;
-      guint8 *d = dest_data + dest_stride * 2 * j;
-
-      for (i = 0; i < src_width; i++) {
-        int v;
-
-        v = -1 * s[CLAMP (i - 3, 0, src_width - 1)]
-            + 3 * s[CLAMP (i - 2, 0, src_width - 1)]
-            + -7 * s[CLAMP (i - 1, 0, src_width - 1)]
-            + 21 * s[CLAMP (i, 0, src_width - 1)]
-            + 21 * s[CLAMP (i + 1, 0, src_width - 1)]
-            + -7 * s[CLAMP (i + 2, 0, src_width - 1)]
-            + 3 * s[CLAMP (i + 3, 0, src_width - 1)]
-            + -1 * s[CLAMP (i + 4, 0, src_width - 1)];
-        v = (v + 16) >> 5;
-        d[i * 2] = s[i];
-        d[i * 2 + 1] = CLAMP (v, 0, 255);
-      }
-    }
-    for (j = 0; j < src_height; j++) {
-      guint8 *d = dest_data;
-
-      for (i = 0; i < src_width * 2; i++) {
-        int v;
-        v = -1 * d[i + CLAMP (2 * j - 6, 0, 2 * src_height - 2) * dest_stride]
-            + 3 * d[i + CLAMP (2 * j - 4, 0, 2 * src_height - 2) * dest_stride]
-            + -7 * d[i + CLAMP (2 * j - 2, 0, 2 * src_height - 2) * dest_stride]
-            + 21 * d[i + CLAMP (2 * j, 0, 2 * src_height - 2) * dest_stride]
-            + 21 * d[i + CLAMP (2 * j + 2, 0, 2 * src_height - 2) * dest_stride]
-            + -7 * d[i + CLAMP (2 * j + 4, 0, 2 * src_height - 2) * dest_stride]
-            + 3 * d[i + CLAMP (2 * j + 6, 0, 2 * src_height - 2) * dest_stride]
-            + -1 * d[i + CLAMP (2 * j + 8, 0,
-                2 * src_height - 2) * dest_stride];
-        v = (v + 16) >> 5;
-        d[i + (2 * j + 1) * dest_stride] = CLAMP (v, 0, 255);
-      }
-    }
+  img->n_components = GST_VIDEO_FRAME_N_COMPONENTS (frame);
+  img->channels = 1;
+  for (k = 0; k < img->n_components; k++) {
+    img->data[k] = GST_VIDEO_FRAME_COMP_DATA (frame, k);
+    img->stride[k] = GST_VIDEO_FRAME_COMP_STRIDE (frame, k);
+    img->pstride[k] = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, k);
+    img->width[k] = GST_VIDEO_FRAME_COMP_WIDTH (frame, k);
+    img->height[k] = GST_VIDEO_FRAME_COMP_HEIGHT (frame, k);
+    img->x_shift[k] = GST_VIDEO_FORMAT_INFO_W_SUB (finfo, k);
+    img->y_shift[k] = GST_VIDEO_FORMAT_INFO_H_SUB (finfo, k);
   }
-  for (k = 1; k < 3; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-    for (j = 0; j < src_height; j++) {
-      guint8 *s1 = src_data + src_stride * j;
-      guint8 *s2 = src_data + src_stride * (j + 1);
-      guint8 *d1 = dest_data + dest_stride * 2 * j;
-      guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-
-      if (j < src_height - 1) {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = (s1[i] + s2[i] + 1) >> 1;
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + s2[i] + s2[i + 1] + 2) >> 2;
-        }
-      } else {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = s1[i];
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-        }
-      }
+}
+
+/* The measurements as a structure, with the object lock held. */
+static GstStructure *
+stats_structure (GstEdiUpsample * edi)
+{
+  GstStructure *s;
+  GValue directions = G_VALUE_INIT;
+  GValue count = G_VALUE_INIT;
+  int d;
+
+  s = gst_structure_new ("ediupsample-stats",
+      "frames", G_TYPE_UINT64, edi->n_frames,
+      "frame-time", G_TYPE_UINT64, edi->frame_time,
+      "mpixels-per-second", G_TYPE_DOUBLE, edi->mpixels_per_second, NULL);
+  if (!edi->have_dir_counts)
+    return s;
+
+  /* the codes after EDI_DIR_MAP_SOURCE are the directions -5 to 5 */
+  g_value_init (&directions, GST_TYPE_ARRAY);
+  g_value_init (&count, G_TYPE_UINT64);
+  for (d = EDI_DIR_MAP_SOURCE + 1; d < EDI_DIR_MAP_N_CODES; d++) {
+    g_value_set_uint64 (&count, edi->dir_counts[d]);
+    gst_value_array_append_value (&directions, &count);
+  }
+  g_value_unset (&count);
+  gst_structure_take_value (s, "directions", &directions);
+
+  return s;
+}
+
+/* Keeps the measurements of a frame of n_pixels output pixels, and posts
+ * them every stats_interval frames.  dir_counts is NULL unless the
+ * method is cgak. */
+static void
+record_stats (GstEdiUpsample * edi, GstClockTime frame_time,
+    guint64 n_pixels, const guint64 * dir_counts)
+{
+  GstStructure *s = NULL;
+
+  GST_OBJECT_LOCK (edi);
+  edi->n_frames++;
+  edi->frame_time = frame_time;
+  /* a running average over roughly the last 8 frames */
+  if (edi->avg_frame_time == 0)
+    edi->avg_frame_time = frame_time;
+  else
+    edi->avg_frame_time += (frame_time - edi->avg_frame_time) / 8;
+  if (edi->avg_frame_time > 0)
+    edi->mpixels_per_second = n_pixels * 1e3 / edi->avg_frame_time;
+  edi->have_dir_counts = dir_counts != NULL;
+  if (dir_counts)
+    memcpy (edi->dir_counts, dir_counts, sizeof (edi->dir_counts));
+  if (edi->stats_interval > 0 && edi->n_frames % edi->stats_interval == 0)
+    s = stats_structure (edi);
+  GST_OBJECT_UNLOCK (edi);
+
+  if (s)
+    gst_element_post_message (GST_ELEMENT (edi),
+        gst_message_new_element (GST_OBJECT (edi), s));
+}
+
+/* The time the input frame in is shown for, from the buffer or else the
+ * frame rate. */
+static GstClockTime
+frame_duration (GstEdiUpsample * edi, GstBuffer * in)
+{
+  GstVideoInfo *info = &GST_VIDEO_FILTER (edi)->in_info;
+
+  if (GST_BUFFER_DURATION_IS_VALID (in))
+    return GST_BUFFER_DURATION (in);
+  if (GST_VIDEO_INFO_FPS_N (info) > 0) {
+    return gst_util_uint64_scale_int (GST_SECOND,
+        GST_VIDEO_INFO_FPS_D (info), GST_VIDEO_INFO_FPS_N (info));
+  }
+  return GST_CLOCK_TIME_NONE;
+}
+
+static void
+reset_auto (GstEdiUpsample * edi)
+{
+  edi->auto_step = 0;
+  edi->auto_cost = 0;
+  edi->auto_frames = 0;
+  edi->auto_calm = 0;
+  edi->auto_hold = AUTO_HOLD;
+  edi->auto_went_up = FALSE;
+  GST_OBJECT_LOCK (edi);
+  edi->qos_late = FALSE;
+  edi->auto_reset = FALSE;
+  GST_OBJECT_UNLOCK (edi);
+}
+
+/* The step of the ladder next to step, below it for dir 1 and above it
+ * for -1, that can be used; -1 when there is none. */
+static int
+auto_next_step (GstEdiUpsample * edi, int step, int dir)
+{
+  for (step += dir; step >= 0 && step < (int) G_N_ELEMENTS (auto_methods);
+      step += dir) {
+    if (!edi->deinterlacing ||
+        edi_can_deinterlace ((EdiMethod) auto_methods[step]))
+      return step;
+  }
+  return -1;
+}
+
+/* Weighs the cost of a frame against its duration, if known, for
+ * method=auto, and moves along auto_methods as described there. */
+static void
+update_auto (GstEdiUpsample * edi, GstClockTime cost, GstClockTime duration)
+{
+  GstEdiUpsampleMethod from = auto_methods[edi->auto_step];
+  gboolean late, pressure, headroom;
+  gdouble load = 0;
+  int down, up;
+
+  GST_OBJECT_LOCK (edi);
+  late = edi->qos_late;
+  edi->qos_late = FALSE;
+  GST_OBJECT_UNLOCK (edi);
+
+  if (edi->auto_cost == 0)
+    edi->auto_cost = cost;
+  else
+    edi->auto_cost += (cost - edi->auto_cost) / 8;
+  if (GST_CLOCK_TIME_IS_VALID (duration) && duration > 0)
+    load = edi->auto_cost / duration;
+  pressure = late || load > AUTO_HIGH;
+  headroom = !late && load < AUTO_LOW;
+
+  edi->auto_frames++;
+  edi->auto_calm = headroom ? edi->auto_calm + 1 : 0;
+  if (edi->auto_went_up && edi->auto_frames == edi->auto_hold)
+    edi->auto_hold = AUTO_HOLD;
+
+  down = auto_next_step (edi, edi->auto_step, 1);
+  up = auto_next_step (edi, edi->auto_step, -1);
+  if (pressure && edi->auto_frames >= AUTO_SETTLE && down >= 0) {
+    if (edi->auto_went_up && edi->auto_frames < edi->auto_hold)
+      edi->auto_hold = MIN (2 * edi->auto_hold, AUTO_MAX_HOLD);
+    edi->auto_step = down;
+    edi->auto_went_up = FALSE;
+  } else if (edi->auto_calm >= edi->auto_hold && up >= 0) {
+    edi->auto_step = up;
+    edi->auto_went_up = TRUE;
+  } else {
+    return;
+  }
+  edi->auto_cost = 0;
+  edi->auto_frames = 0;
+  edi->auto_calm = 0;
+
+  GST_INFO_OBJECT (edi, "load %.2f%s, switching from %d to method %d", load,
+      late ? " and late" : "", from, auto_methods[edi->auto_step]);
+  gst_element_post_message (GST_ELEMENT (edi),
+      gst_message_new_element (GST_OBJECT (edi),
+          gst_structure_new ("ediupsample-method",
+              "method", GST_TYPE_EDI_METHOD, auto_methods[edi->auto_step],
+              "previous-method", GST_TYPE_EDI_METHOD, from,
+              "load", G_TYPE_DOUBLE, load, "late", G_TYPE_BOOLEAN, late,
+              NULL)));
+}
+
+/* Points params at the rectangle of the input to upsample, the part of
+ * inframe its crop meta shows with the roi the caps were made for taken
+ * out of that.  FALSE when it is not inside the frame. */
+static void
+clear_dir_map_pool (GstEdiUpsample * edi)
+{
+  if (edi->dir_map_pool) {
+    gst_buffer_pool_set_active (edi->dir_map_pool, FALSE);
+    gst_object_unref (edi->dir_map_pool);
+    edi->dir_map_pool = NULL;
+  }
+}
+
+/* A buffer of size bytes for a direction map.  It comes back to the pool
+ * when the meta it goes to is freed, so that the maps are not allocated
+ * again every frame. */
+static GstBuffer *
+acquire_dir_map (GstEdiUpsample * edi, guint size)
+{
+  GstBuffer *map = NULL;
+  GstStructure *config;
+
+  if (edi->dir_map_pool && edi->dir_map_size != size)
+    clear_dir_map_pool (edi);
+  if (edi->dir_map_pool == NULL) {
+    edi->dir_map_pool = gst_buffer_pool_new ();
+    edi->dir_map_size = size;
+    config = gst_buffer_pool_get_config (edi->dir_map_pool);
+    gst_buffer_pool_config_set_params (config, NULL, size, 0, 0);
+    if (!gst_buffer_pool_set_config (edi->dir_map_pool, config) ||
+        !gst_buffer_pool_set_active (edi->dir_map_pool, TRUE)) {
+      clear_dir_map_pool (edi);
+      return NULL;
     }
   }
 
-  return GST_FLOW_OK;
+  if (gst_buffer_pool_acquire_buffer (edi->dir_map_pool, &map,
+          NULL) != GST_FLOW_OK)
+    return NULL;
+  return map;
+}
+
+static gboolean
+set_roi (GstEdiUpsample * edi, EdiParams * params, GstVideoFrame * inframe)
+{
+  GstVideoFilter *filter = GST_VIDEO_FILTER (edi);
+  GstVideoCropMeta *crop = gst_buffer_get_video_crop_meta (inframe->buffer);
+  int x = 0, y = 0;
+  int width = GST_VIDEO_INFO_WIDTH (&filter->in_info);
+  int height = GST_VIDEO_INFO_HEIGHT (&filter->in_info);
+
+  /* the caps have the size of the crop, the frame that of the buffer */
+  if (crop) {
+    x = crop->x;
+    y = crop->y;
+  }
+  if (edi->out_roi.w > 0) {
+    x += edi->out_roi.x;
+    y += edi->out_roi.y;
+    width = edi->out_roi.w;
+    height = edi->out_roi.h;
+  }
+  if (x + width > GST_VIDEO_FRAME_WIDTH (inframe) ||
+      y + height > GST_VIDEO_FRAME_HEIGHT (inframe))
+    return FALSE;
+
+  if (width < GST_VIDEO_FRAME_WIDTH (inframe) ||
+      height < GST_VIDEO_FRAME_HEIGHT (inframe)) {
+    params->roi_x = x;
+    params->roi_y = y;
+    params->roi_width = width;
+    params->roi_height = height;
+  }
+  return TRUE;
 }
 
+/* edi.c fills the map of the meta */
+G_STATIC_ASSERT (GST_EDI_DIR_META_SOURCE == EDI_DIR_MAP_SOURCE);
+G_STATIC_ASSERT (GST_EDI_DIR_META_FLAT == EDI_DIR_MAP_FLAT);
+
+/* While deinterlacing, each frame goes through transform_frame twice,
+ * once per field: the frame queued by submit_input_buffer is kept, and
+ * queued again once its first field is out.  The fields share its
+ * duration. */
 static GstFlowReturn
-gst_edi_upsample_transform_frame_bilinear (GstVideoFilter * filter,
-    GstVideoFrame * inframe, GstVideoFrame * outframe)
+gst_edi_upsample_generate_output (GstBaseTransform * trans,
+    GstBuffer ** outbuf)
 {
-  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (filter);
-  int k;
-  int i, j;
-  guint8 *src_data;
-  int src_stride;
-  int src_width;
-  int src_height;
-  guint8 *dest_data;
-  int dest_stride;
+  GstEdiUpsample *edi = GST_EDI_UPSAMPLE (trans);
+  GstBaseTransformClass *parent_class =
+      GST_BASE_TRANSFORM_CLASS (gst_edi_upsample_parent_class);
+  GstClockTime pts, duration;
+  GstFlowReturn ret;
 
-  GST_DEBUG_OBJECT (edi, "transform_frame");
+  if (!edi->deinterlacing)
+    return parent_class->generate_output (trans, outbuf);
 
-  for (k = 0; k < 1; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-    for (j = 0; j < src_height; j++) {
-      guint8 *s = src_data + src_stride * j;
-      guint8 *d = dest_data + dest_stride * 2 * j;
-
-      for (i = 0; i < src_width; i++) {
-        int v;
-
-        if (i < src_width - 1) {
-          v = (s[i] + s[i + 1] + 1) >> 1;
-          d[i * 2] = s[i];
-          d[i * 2 + 1] = CLAMP (v, 0, 255);
-        } else {
-          d[i * 2] = s[i];
-          d[i * 2 + 1] = s[i];
-        }
-      }
-    }
-    for (j = 0; j < src_height; j++) {
-      guint8 *d = dest_data + dest_stride * (2 * j + 1);
-
-      if (j < src_height - 1) {
-        for (i = 0; i < src_width * 2; i++) {
-          int v;
-          v = (d[i - 1 * dest_stride] + d[i + 1 * dest_stride] + 1) >> 1;
-          d[i] = CLAMP (v, 0, 255);
-        }
-      } else {
-        for (i = 0; i < src_width * 2; i++) {
-          d[i] = d[i - dest_stride];
-        }
-      }
-    }
+  if (trans->queued_buf) {
+    gst_buffer_replace (&edi->field_buf, trans->queued_buf);
+    edi->field_index = 0;
+  } else if (edi->field_buf) {
+    trans->queued_buf = edi->field_buf;
+    edi->field_buf = NULL;
+    edi->field_index = 1;
+  } else {
+    return parent_class->generate_output (trans, outbuf);
   }
-  for (k = 1; k < 3; k++) {
-    src_data = inframe->data[k];
-    src_stride = GST_VIDEO_FRAME_COMP_STRIDE (inframe, k);
-    src_width = GST_VIDEO_FRAME_COMP_WIDTH (inframe, k);
-    src_height = GST_VIDEO_FRAME_COMP_HEIGHT (inframe, k);
-
-    dest_data = outframe->data[k];
-    dest_stride = GST_VIDEO_FRAME_COMP_STRIDE (outframe, k);
-
-    for (j = 0; j < src_height; j++) {
-      guint8 *s1 = src_data + src_stride * j;
-      guint8 *s2 = src_data + src_stride * (j + 1);
-      guint8 *d1 = dest_data + dest_stride * 2 * j;
-      guint8 *d2 = dest_data + dest_stride * (2 * j + 1);
-
-      if (j < src_height - 1) {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = (s1[i] + s2[i] + 1) >> 1;
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + s2[i] + s2[i + 1] + 2) >> 2;
-        }
-      } else {
-        for (i = 0; i < src_width; i++) {
-          d1[i * 2] = s1[i];
-          d1[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-          d2[i * 2] = s1[i];
-          d2[i * 2 + 1] = (s1[i] + s1[i + 1] + 1) >> 1;
-        }
-      }
-    }
+
+  pts = GST_BUFFER_PTS (trans->queued_buf);
+  duration = frame_duration (edi, trans->queued_buf);
+
+  ret = parent_class->generate_output (trans, outbuf);
+  if (ret != GST_FLOW_OK || *outbuf == NULL) {
+    /* neither field of a dropped frame goes out */
+    gst_buffer_replace (&edi->field_buf, NULL);
+    return ret;
   }
 
-  return GST_FLOW_OK;
+  *outbuf = gst_buffer_make_writable (*outbuf);
+  if (GST_CLOCK_TIME_IS_VALID (duration)) {
+    GST_BUFFER_DURATION (*outbuf) = duration / 2;
+    if (edi->field_index == 1 && GST_CLOCK_TIME_IS_VALID (pts))
+      GST_BUFFER_PTS (*outbuf) = pts + duration / 2;
+  }
+  if (edi->field_index == 1)
+    GST_BUFFER_FLAG_UNSET (*outbuf, GST_BUFFER_FLAG_DISCONT);
+  GST_BUFFER_FLAG_UNSET (*outbuf, GST_VIDEO_BUFFER_FLAG_INTERLACED |
+      GST_VIDEO_BUFFER_FLAG_TFF | GST_VIDEO_BUFFER_FLAG_RFF |
+      GST_VIDEO_BUFFER_FLAG_ONEFIELD);
+
+  return ret;
 }
 
 static GstFlowReturn
@@ -782,21 +1408,133 @@ gst_edi_upsample_transform_frame (GstVideoFilter * filter,
     GstVideoFrame * inframe, GstVideoFrame * outframe)
 {
   GstEdiUpsample *edi = GST_EDI_UPSAMPLE (filter);
-  GstFlowReturn ret;
+  GstVideoFrame prev_in, prev_out;
+  EdiImage in, out, prev_src, prev_dest;
+  EdiParams params = { 0, };
+  guint64 dir_counts[EDI_DIR_MAP_N_CODES];
+  GstEdiUpsampleMethod method;
+  GstClockTime start = 0, cost, duration;
+  gboolean instrument, top_first, automatic, reset;
+  guint n_threads;
+  int field = 0;
 
-  switch (edi->method) {
-    case GST_EDI_UPSAMPLE_METHOD_CGAK:
-      ret = gst_edi_upsample_transform_frame_cgak (filter, inframe, outframe);
-      break;
-    case GST_EDI_UPSAMPLE_METHOD_BILINEAR:
-      ret =
-          gst_edi_upsample_transform_frame_bilinear (filter, inframe, outframe);
-      break;
-    case GST_EDI_UPSAMPLE_METHOD_DIRAC:
-      ret = gst_edi_upsample_transform_frame_dirac (filter, inframe, outframe);
-      break;
-    default:
-      g_assert_not_reached ();
+  GST_DEBUG_OBJECT (edi, "transform_frame");
+
+  GST_OBJECT_LOCK (edi);
+  n_threads = edi->n_threads;
+  instrument = edi->instrument;
+  method = edi->method;
+  reset = edi->auto_reset;
+  GST_OBJECT_UNLOCK (edi);
+
+  automatic = method == GST_EDI_UPSAMPLE_METHOD_AUTO;
+  if (reset)
+    reset_auto (edi);
+
+  if (!edi->upsampler)
+    edi->upsampler = edi_upsampler_new (n_threads);
+  else
+    edi_upsampler_set_n_threads (edi->upsampler, n_threads);
+
+  image_from_frame (&in, inframe);
+  image_from_frame (&out, outframe);
+
+  if (automatic)
+    method = auto_methods[edi->auto_step];
+  params.method = (EdiMethod) method;
+  params.chroma_mode = (EdiChromaMode) edi->chroma_mode;
+  params.n_stages = edi->n_stages;
+  params.padding = edi->out_padding;
+  if (edi->deinterlacing) {
+    /* the frame or else the caps tell which field comes first */
+    top_first = GST_VIDEO_FRAME_IS_TFF (inframe) ||
+        GST_VIDEO_INFO_FIELD_ORDER (&filter->in_info) ==
+        GST_VIDEO_FIELD_ORDER_TOP_FIRST;
+    field = top_first ? edi->field_index : !edi->field_index;
+    /* the edge-directed methods other than cgak have no field pass */
+    if (!edi_can_deinterlace (params.method))
+      params.method = EDI_METHOD_CGAK;
+  } else if (!set_roi (edi, &params, inframe)) {
+    GST_ELEMENT_ERROR (edi, STREAM, FAILED, (NULL),
+        ("the region to upsample is outside the %dx%d frame",
+            GST_VIDEO_FRAME_WIDTH (inframe),
+            GST_VIDEO_FRAME_HEIGHT (inframe)));
+    return GST_FLOW_ERROR;
   }
-  return ret;
+  /* a map of the whole output is only made of the whole input */
+  if (method == GST_EDI_UPSAMPLE_METHOD_CGAK && edi->direction_meta &&
+      params.roi_width == 0 && !edi->deinterlacing) {
+    GstBuffer *map = acquire_dir_map (edi,
+        GST_EDI_DIR_META_SIZE (out.width[0], out.height[0]));
+    GstEdiDirMeta *meta = map ? gst_buffer_add_edi_dir_meta (outframe->buffer,
+        out.width[0], out.height[0], map) : NULL;
+
+    /* without it the frame still goes out, just without a map */
+    if (meta) {
+      params.dir_map = meta->data;
+      params.dir_map_stride = meta->stride;
+    } else {
+      GST_WARNING_OBJECT (edi, "could not add the direction meta");
+    }
+  }
+
+  /* The output goes out to be written to downstream, so the next frame
+   * starts from a copy of it that the upsampler keeps up to date, which
+   * after the first frame takes only the rows upsampled again. */
+  if (!edi->skip_unchanged || params.dir_map || params.roi_width ||
+      edi->deinterlacing) {
+    gst_buffer_replace (&edi->prev_outbuf, NULL);
+  } else {
+    if (edi->prev_outbuf == NULL) {
+      edi->prev_outbuf = gst_buffer_new_allocate (NULL,
+          GST_VIDEO_INFO_SIZE (&filter->out_info), NULL);
+    }
+    if (edi->prev_outbuf && gst_video_frame_map (&prev_out,
+            &filter->out_info, edi->prev_outbuf, GST_MAP_READWRITE)) {
+      image_from_frame (&prev_dest, &prev_out);
+      params.save_dest = &prev_dest;
+      if (edi->prev_inbuf && gst_video_frame_map (&prev_in,
+              &filter->in_info, edi->prev_inbuf, GST_MAP_READ)) {
+        image_from_frame (&prev_src, &prev_in);
+        params.prev_src = &prev_src;
+        params.prev_dest = &prev_dest;
+      }
+    }
+  }
+
+  if (instrument && method == GST_EDI_UPSAMPLE_METHOD_CGAK &&
+      !edi->deinterlacing) {
+    memset (dir_counts, 0, sizeof (dir_counts));
+    params.dir_counts = dir_counts;
+  }
+  if (instrument || automatic)
+    start = gst_util_get_timestamp ();
+
+  if (edi->deinterlacing)
+    edi_upsampler_deinterlace (edi->upsampler, &params, &in, field, &out);
+  else
+    edi_upsampler_run (edi->upsampler, &params, &in, &out);
+
+  if (instrument || automatic) {
+    cost = gst_util_get_timestamp () - start;
+    if (instrument) {
+      record_stats (edi, cost, (guint64) out.width[0] * out.height[0],
+          params.dir_counts);
+    }
+    if (automatic) {
+      duration = frame_duration (edi, inframe->buffer);
+      if (edi->deinterlacing && GST_CLOCK_TIME_IS_VALID (duration))
+        duration /= 2;
+      update_auto (edi, cost, duration);
+    }
+  }
+
+  if (params.prev_src)
+    gst_video_frame_unmap (&prev_in);
+  if (params.save_dest)
+    gst_video_frame_unmap (&prev_out);
+  gst_buffer_replace (&edi->prev_inbuf,
+      params.save_dest ? inframe->buffer : NULL);
+
+  return GST_FLOW_OK;
 }
@@ -23,6 +23,7 @@
 
 #include <gst/video/video.h>
 #include <gst/video/gstvideofilter.h>
+#include "edi.h"
 
 G_BEGIN_DECLS
 
@@ -35,17 +36,85 @@ G_BEGIN_DECLS
 typedef struct _GstEdiUpsample GstEdiUpsample;
 typedef struct _GstEdiUpsampleClass GstEdiUpsampleClass;
 
+/* the same values as EdiMethod and EdiChromaMode, but for auto, which
+ * picks one of them per frame */
 typedef enum {
   GST_EDI_UPSAMPLE_METHOD_CGAK,
   GST_EDI_UPSAMPLE_METHOD_BILINEAR,
-  GST_EDI_UPSAMPLE_METHOD_DIRAC
+  GST_EDI_UPSAMPLE_METHOD_DIRAC,
+  GST_EDI_UPSAMPLE_METHOD_EDI_HV,
+  GST_EDI_UPSAMPLE_METHOD_EDI_VH,
+  GST_EDI_UPSAMPLE_METHOD_DAALA,
+  GST_EDI_UPSAMPLE_METHOD_AUTO
 } GstEdiUpsampleMethod;
 
+typedef enum {
+  GST_EDI_UPSAMPLE_CHROMA_MODE_BILINEAR,
+  GST_EDI_UPSAMPLE_CHROMA_MODE_LUMA_GUIDED
+} GstEdiUpsampleChromaMode;
+
 struct _GstEdiUpsample
 {
   GstVideoFilter base_edi;
 
   GstEdiUpsampleMethod method;
+  guint n_threads;
+  GstEdiUpsampleChromaMode chroma_mode;
+  gboolean direction_meta;
+  guint factor;
+  gboolean skip_unchanged;
+  guint padding;
+  gboolean instrument;
+  guint stats_interval;
+  /* the rectangle of the input to upsample, all of it when w is 0 */
+  GstVideoRectangle roi;
+  gboolean deinterlace;
+
+  /* cascade of 2x steps for the negotiated caps */
+  int n_stages;
+  /* border of the output buffers from the negotiated pool */
+  int out_padding;
+  /* the roi the caps were made for, or w 0 */
+  GstVideoRectangle out_roi;
+  /* whether the caps are for deinterlacing, to a frame per field */
+  gboolean deinterlacing;
+  /* while deinterlacing, the frame whose second field is still to go
+   * out, and which field of its frame is being made, 0 or 1 */
+  GstBuffer *field_buf;
+  int field_index;
+
+  EdiUpsampler *upsampler;
+  /* the buffers the direction maps are kept in, of dir_map_size bytes */
+  GstBufferPool *dir_map_pool;
+  guint dir_map_size;
+  /* while skipping unchanged rows, the last input and a copy of what was
+   * made of it */
+  GstBuffer *prev_inbuf;
+  GstBuffer *prev_outbuf;
+
+  /* the measurements of the last frames while instrumenting, under the
+   * object lock */
+  guint64 n_frames;
+  GstClockTime frame_time;
+  gdouble avg_frame_time;
+  gdouble mpixels_per_second;
+  gboolean have_dir_counts;
+  guint64 dir_counts[EDI_DIR_MAP_N_CODES];
+
+  /* method=auto: the step of its ladder in use, the average cost of a
+   * frame there, the frames since the last step and how many of them in
+   * a row had headroom, how many that takes to step up, and whether the
+   * last step was up */
+  int auto_step;
+  gdouble auto_cost;
+  guint auto_frames;
+  guint auto_calm;
+  guint auto_hold;
+  gboolean auto_went_up;
+  /* whether a QoS event said downstream is behind since the last frame,
+   * and whether method was set since then, under the object lock */
+  gboolean qos_late;
+  gboolean auto_reset;
 };
 
 struct _GstEdiUpsampleClass